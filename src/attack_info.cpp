@@ -0,0 +1,91 @@
+#include "chess.hpp"
+#include "attack_info.hpp"
+
+using namespace chess;
+using namespace std;
+
+void compute_checkers(const Board& board, AttackInfo& info){
+    Color us = board.sideToMove();
+    Square king_sq = board.kingSq(us);
+    Bitboard occ = board.occ();
+    Bitboard them = board.us(~us);
+
+    info.checkers = ((attacks::knight(king_sq) & board.pieces(PieceType::KNIGHT))
+                  | (attacks::pawn(us, king_sq) & board.pieces(PieceType::PAWN))
+                  | (attacks::bishop(king_sq, occ) & board.pieces(PieceType::BISHOP, PieceType::QUEEN))
+                  | (attacks::rook(king_sq, occ) & board.pieces(PieceType::ROOK, PieceType::QUEEN))).getBits() & them.getBits();
+
+    info.has_pins = false;
+    info.has_piece_attacks = false;
+}
+
+void compute_pins(const Board& board, AttackInfo& info){
+    Color us = board.sideToMove();
+    Square king_sq = board.kingSq(us);
+    Bitboard occ = board.occ();
+    Bitboard them = board.us(~us);
+
+    Bitboard diagonal = them & board.pieces(PieceType::BISHOP, PieceType::QUEEN);
+    Bitboard orthogonal = them & board.pieces(PieceType::ROOK, PieceType::QUEEN);
+
+    // Sliders that would see our king through exactly one of our pieces.
+    // The squares between a slider and the king are where the two rays
+    // cast from each end (blocked only by the other end) overlap
+    Bitboard king_bb = Bitboard::fromSquare(king_sq);
+    Bitboard ours = board.us(us);
+    info.pinned = 0ull;
+
+    Bitboard snipers = attacks::bishop(king_sq, them) & diagonal;
+    while (snipers){
+        Square sniper = static_cast<Square>(snipers.pop());
+        Bitboard between = attacks::bishop(king_sq, Bitboard::fromSquare(sniper)) & attacks::bishop(sniper, king_bb) & occ;
+        if (between.count() == 1 && (between & ours))
+            info.pinned |= between.getBits();
+    }
+
+    snipers = attacks::rook(king_sq, them) & orthogonal;
+    while (snipers){
+        Square sniper = static_cast<Square>(snipers.pop());
+        Bitboard between = attacks::rook(king_sq, Bitboard::fromSquare(sniper)) & attacks::rook(sniper, king_bb) & occ;
+        if (between.count() == 1 && (between & ours))
+            info.pinned |= between.getBits();
+    }
+
+    info.has_pins = true;
+}
+
+void compute_piece_attacks(const Board& board, AttackInfo& info){
+    Bitboard occ = board.occ();
+
+    Bitboard knights = board.pieces(PieceType::KNIGHT);
+    while (knights){
+        int32_t sq = knights.pop();
+        info.piece_attacks[sq] = attacks::knight(static_cast<Square>(sq)).getBits();
+    }
+
+    Bitboard bishops = board.pieces(PieceType::BISHOP);
+    while (bishops){
+        int32_t sq = bishops.pop();
+        info.piece_attacks[sq] = attacks::bishop(static_cast<Square>(sq), occ).getBits();
+    }
+
+    Bitboard rooks = board.pieces(PieceType::ROOK);
+    while (rooks){
+        int32_t sq = rooks.pop();
+        info.piece_attacks[sq] = attacks::rook(static_cast<Square>(sq), occ).getBits();
+    }
+
+    Bitboard queens = board.pieces(PieceType::QUEEN);
+    while (queens){
+        int32_t sq = queens.pop();
+        info.piece_attacks[sq] = attacks::queen(static_cast<Square>(sq), occ).getBits();
+    }
+
+    Bitboard kings = board.pieces(PieceType::KING);
+    while (kings){
+        int32_t sq = kings.pop();
+        info.piece_attacks[sq] = attacks::king(static_cast<Square>(sq)).getBits();
+    }
+
+    info.has_piece_attacks = true;
+}
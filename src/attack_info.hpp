@@ -0,0 +1,36 @@
+#pragma once
+
+#include <cstdint>
+
+#include "chess.hpp"
+
+// Attack information of a position, computed once per node and shared by
+// everything that needs it instead of each redoing the slider lookups.
+// Checkers are always filled in, pins and the per-piece attack maps only
+// once something asks for them (see SearchThread::attack_info)
+struct AttackInfo {
+    // Enemy pieces giving check to the side to move
+    uint64_t checkers = 0ull;
+
+    // Pieces of the side to move pinned to their own king
+    uint64_t pinned = 0ull;
+    bool has_pins = false;
+
+    // Squares attacked by the knight, bishop, rook, queen or king on each
+    // square. Pawns are left out, their terms come from the pawn hash
+    uint64_t piece_attacks[64]{};
+    bool has_piece_attacks = false;
+
+    bool in_check() const {
+        return checkers != 0ull;
+    }
+};
+
+// Fills in checkers, marks pins and attack maps as not computed yet
+void compute_checkers(const chess::Board& board, AttackInfo& info);
+
+// Fills in pinned
+void compute_pins(const chess::Board& board, AttackInfo& info);
+
+// Fills in the per-piece attack maps
+void compute_piece_attacks(const chess::Board& board, AttackInfo& info);
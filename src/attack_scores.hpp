@@ -0,0 +1,91 @@
+#pragma once
+
+#include <cstdint>
+
+// Batching only wins with a native 64 bit vector popcount. AVX2 and scalar
+// builds score every attack as soon as it is added, which measured faster
+#if defined(__AVX512F__) && defined(__AVX512VPOPCNTDQ__)
+#include <immintrin.h>
+#define USE_ATTACK_BATCH 1
+#endif
+
+// Every attacked target that is scored, for threats and king safety: the
+// six enemy piece bitboards, then the inner and outer ring around the
+// enemy king
+constexpr int32_t ATTACK_TARGETS = 8;
+
+// A side has at most 15 non pawn pieces plus the king
+constexpr int32_t MAX_ATTACKERS = 16;
+
+// Name of the attack scoring this build uses, for evalbench
+#if defined(USE_ATTACK_BATCH)
+inline constexpr const char* ATTACK_SCORING = "avx512-vpopcntq batch";
+#else
+inline constexpr const char* ATTACK_SCORING = "scalar";
+#endif
+
+// Threats and king zone attacks of all of one side's pieces. Each attack
+// map comes with the packed S(mg, eg) weight of an attacked square on each
+// target, score() is the sum of popcount(attacks & target) * weight
+#if defined(USE_ATTACK_BATCH)
+
+struct AttackBatch {
+    const uint64_t* targets;
+    uint64_t attacks[MAX_ATTACKERS];
+    const int32_t* weights[MAX_ATTACKERS];
+    int32_t size = 0;
+
+    explicit AttackBatch(const uint64_t* targets) : targets(targets) {}
+
+    // Targets past the first Targets have zero weight, the vector scores
+    // all eight anyway
+    template <int32_t Targets = ATTACK_TARGETS>
+    void add(uint64_t attacks_bb, const int32_t* target_weights) {
+        attacks[size] = attacks_bb;
+        weights[size] = target_weights;
+        size++;
+    }
+
+    // All eight targets in one register. Counts fit in the low 32 bits of
+    // each lane, so mul_epi32 with the sign extended weights gives the
+    // exact products. The maskz forms keep GCC from warning about the
+    // undefined upper lanes of the plain ones
+    int32_t score() const {
+        __m512i all_targets = _mm512_loadu_si512(targets);
+        __m512i sum = _mm512_setzero_si512();
+
+        for (int32_t i = 0; i < size; i++) {
+            __m512i attacked = _mm512_and_si512(_mm512_set1_epi64(static_cast<int64_t>(attacks[i])), all_targets);
+            __m512i counts = _mm512_maskz_popcnt_epi64(0xFF, attacked);
+            __m512i target_weights = _mm512_maskz_cvtepi32_epi64(0xFF, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(weights[i])));
+            sum = _mm512_add_epi64(sum, _mm512_maskz_mul_epi32(0xFF, counts, target_weights));
+        }
+
+        __m256i quarter = _mm256_add_epi64(_mm512_maskz_extracti64x4_epi64(0xFF, sum, 0), _mm512_maskz_extracti64x4_epi64(0xFF, sum, 1));
+        __m128i half = _mm_add_epi64(_mm256_castsi256_si128(quarter), _mm256_extracti128_si256(quarter, 1));
+        half = _mm_add_epi64(half, _mm_unpackhi_epi64(half, half));
+        return static_cast<int32_t>(_mm_cvtsi128_si64(half));
+    }
+};
+
+#else
+
+struct AttackBatch {
+    const uint64_t* targets;
+    int32_t total = 0;
+
+    explicit AttackBatch(const uint64_t* targets) : targets(targets) {}
+
+    // Targets past the first Targets have zero weight and are skipped
+    template <int32_t Targets = ATTACK_TARGETS>
+    void add(uint64_t attacks_bb, const int32_t* target_weights) {
+        for (int32_t t = 0; t < Targets; t++)
+            total += target_weights[t] * __builtin_popcountll(attacks_bb & targets[t]);
+    }
+
+    int32_t score() const {
+        return total;
+    }
+};
+
+#endif
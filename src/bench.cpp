@@ -1,11 +1,24 @@
 #include <cstdint>
+#include <algorithm>
 #include <iostream>
 #include <string>
+#include <chrono>
+#include <vector>
+#include <utility>
+#include <thread>
+#include <atomic>
+#include <random>
+#include <set>
 
 #include "chess.hpp"
 #include "search.hpp"
 #include "timeman.hpp"
 #include "search_info.hpp"
+#include "search_thread.hpp"
+#include "see.hpp"
+#include "transposition.hpp"
+#include "eval.hpp"
+#include "attack_scores.hpp"
 
 using namespace std;
 using namespace chess;
@@ -64,18 +77,192 @@ const string bench_positions[] = {
     "2r2b2/5p2/5k2/p1r1pP2/P2pB3/1P3P2/K1P3R1/7R w - - 23 93"
 };
 
+static void print_hit_rate(const string &name, int64_t hits, int64_t probes){
+    cout << name << " hit rate " << (hits * 100) / max(probes, int64_t(1))
+         << "% (" << hits << "/" << probes << ")" << endl;
+}
+
+void print_cache_stats(){
+    int64_t pawn_hits = 0, pawn_probes = 0, eval_hits = 0, eval_probes = 0, lazy_cutoffs = 0, lazy_probes = 0;
+    for (auto &thread : search_threads){
+        pawn_hits += thread->pawn_table.hits;
+        pawn_probes += thread->pawn_table.probes;
+        eval_hits += thread->eval_cache.hits;
+        eval_probes += thread->eval_cache.probes;
+        lazy_cutoffs += thread->lazy_eval_cutoffs;
+        lazy_probes += thread->lazy_eval_probes;
+    }
+    print_hit_rate("pawn hash", pawn_hits, pawn_probes);
+    print_hit_rate("eval cache", eval_hits, eval_probes);
+    print_hit_rate("lazy eval", lazy_cutoffs, lazy_probes);
+}
+
+void reset_cache_stats(){
+    for (auto &thread : search_threads){
+        thread->pawn_table.hits = thread->pawn_table.probes = 0;
+        thread->eval_cache.hits = thread->eval_cache.probes = 0;
+        thread->lazy_eval_cutoffs = thread->lazy_eval_probes = 0;
+    }
+}
+
 void bench(int32_t depth){
     int64_t node_count = 0ll;
-    search_start_time = chrono::system_clock::now();
+    int64_t saved_evals = 0ll;
+    SearchThread &thread = *search_threads[0];
+    reset_cache_stats();
+    search_start_time = chrono::steady_clock::now();
     for (int32_t i = 0; i < 50; i++){
         string fen = bench_positions[i];
-        Board board = Board(fen);
-        total_nodes = 0ull;
+        thread.set_board(Board(fen));
+        thread.total_nodes = 0ull;
+        thread.saved_evals = 0ll;
+        thread.stopped = false;
         max_hard_time_ms = 10000000000ll;
         max_soft_time_ms = 10000000000ll;
         SearchInfo info{};
-        alpha_beta(board, depth, DEFAULT_ALPHA, DEFAULT_BETA, 0, false, info);
-        node_count += total_nodes;
+        alpha_beta(thread, depth, DEFAULT_ALPHA, DEFAULT_BETA, 0, false, info);
+        node_count += thread.nodes();
+        saved_evals += thread.saved_evals;
     }
+
+    // Keep the nodes/nps line last, that's what OpenBench reads
+    cout << saved_evals << " evals saved by the TT" << endl;
+    print_cache_stats();
     cout << node_count << " nodes " <<  (1000 * node_count) / (elapsed_ms() + 1)  << " nps" << endl;
 }
+
+// Times SEE on its own so changes to it can be measured without the noise
+// of a whole search. The positions and captures are set up first, so only
+// the see() calls themselves are timed
+void see_bench(int32_t iterations){
+    vector<pair<Board, Movelist>> positions;
+    int64_t captures_per_iteration = 0;
+    for (const string &fen : bench_positions){
+        Board board(fen);
+        Movelist captures{};
+        movegen::legalmoves<movegen::MoveGenType::CAPTURE>(captures, board);
+        captures_per_iteration += captures.size();
+        positions.emplace_back(board, captures);
+    }
+
+    // Keeps the compiler from throwing the calls away
+    int64_t good_captures = 0;
+
+    auto start = chrono::steady_clock::now();
+    for (int32_t i = 0; i < iterations; i++){
+        for (const auto &[board, captures] : positions){
+            for (const Move &move : captures)
+                good_captures += see(board, move, 0);
+        }
+    }
+    int64_t elapsed_ns = chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - start).count();
+
+    int64_t calls = captures_per_iteration * iterations;
+    cout << calls << " see calls " << good_captures << " good " << elapsed_ns / (calls + 1) << " ns/call" << endl;
+}
+
+// Times the HCE on its own. The positions are the bench positions and all
+// their children, with accumulators and attack maps set up beforehand so
+// only evaluate() is timed. To compare instruction sets, build with
+// different ARCH and compare the times, the eval sums must match
+void eval_bench(int32_t iterations){
+    struct EvalPosition {
+        Board board;
+        EvalAccumulator acc;
+        AttackInfo info;
+    };
+
+    vector<EvalPosition> positions;
+    auto add_position = [&](const Board &board){
+        EvalPosition position{ board, accumulator_from_board(board), AttackInfo{} };
+        compute_piece_attacks(position.board, position.info);
+        positions.push_back(position);
+    };
+    for (const string &fen : bench_positions){
+        Board board(fen);
+        add_position(board);
+        Movelist moves{};
+        movegen::legalmoves(moves, board);
+        for (const Move &move : moves){
+            board.makeMove(move);
+            add_position(board);
+            board.unmakeMove(move);
+        }
+    }
+
+    // Keeps the compiler from throwing the calls away
+    int64_t eval_sum = 0;
+
+    auto start = chrono::steady_clock::now();
+    for (int32_t i = 0; i < iterations; i++){
+        for (const EvalPosition &position : positions)
+            eval_sum += evaluate(position.board, position.acc, position.info);
+    }
+    int64_t elapsed_ns = chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - start).count();
+
+    int64_t calls = static_cast<int64_t>(positions.size()) * iterations;
+    cout << ATTACK_SCORING << ": " << calls << " evals " << elapsed_ns / (calls + 1) << " ns/eval, eval sum " << eval_sum << endl;
+}
+
+// Every stored entry is derived from its key, so a probe that hits can be
+// checked on its own: a torn or mixed up entry shows up as a score, depth,
+// bound or move that doesn't belong to the key we probed. The key pool is
+// small so the threads keep fighting over the same clusters, and only keys
+// with a unique (cluster, partial key) pair are used, so a legit partial
+// key collision can't be mistaken for corruption
+void tt_stress(int32_t thread_count, int64_t operations){
+    TranspositionTable table(1);
+    const int32_t pool_size = 1 << 14;
+
+    mt19937_64 rng(0xC0FFEE);
+    vector<uint64_t> keys;
+    set<pair<uint64_t, uint16_t>> seen;
+    while (keys.size() < pool_size){
+        uint64_t key = rng();
+        uint64_t cluster = static_cast<uint64_t>((static_cast<unsigned __int128>(key) * (1024 * 1024 / sizeof(TTCluster))) >> 64);
+        if (seen.insert({cluster, static_cast<uint16_t>(key)}).second)
+            keys.push_back(key);
+    }
+
+    auto score_of = [](uint64_t key) { return static_cast<int32_t>(key >> 20) % 30000; };
+    auto depth_of = [](uint64_t key) { return static_cast<int32_t>(key >> 40) % 100; };
+    auto type_of = [](uint64_t key) { return static_cast<NodeType>((key >> 50) % 3); };
+    auto move_of = [](uint64_t key) { return static_cast<uint16_t>((key >> 24) | 1); };
+
+    atomic<int64_t> hits{0};
+    atomic<int64_t> corrupt{0};
+
+    auto worker = [&](int32_t id){
+        mt19937_64 thread_rng(id);
+        int64_t local_hits = 0;
+        int64_t local_corrupt = 0;
+        for (int64_t i = 0; i < operations; i++){
+            uint64_t key = keys[thread_rng() % pool_size];
+            if (thread_rng() & 1){
+                table.store(key, score_of(key), 0, depth_of(key), type_of(key), move_of(key), false);
+                continue;
+            }
+
+            TTEntry entry{};
+            if (table.probe(key, entry)){
+                local_hits++;
+                if (entry.score != score_of(key) || entry.depth != depth_of(key)
+                    || entry.type != type_of(key) || entry.best_move != move_of(key))
+                    local_corrupt++;
+            }
+        }
+        hits += local_hits;
+        corrupt += local_corrupt;
+    };
+
+    auto start = chrono::steady_clock::now();
+    vector<thread> workers;
+    for (int32_t id = 0; id < thread_count; id++)
+        workers.emplace_back(worker, id);
+    for (auto &t : workers)
+        t.join();
+    int64_t elapsed = chrono::duration_cast<chrono::milliseconds>(chrono::steady_clock::now() - start).count();
+
+    cout << thread_count << " threads " << operations * thread_count << " operations " << hits << " hits "
+         << corrupt << " corrupt " << elapsed << " ms" << endl;
+}
\ No newline at end of file
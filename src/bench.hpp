@@ -1,4 +1,20 @@
 #pragma once
 #include <cstdint>
 
-void bench(int32_t depth);
\ No newline at end of file
+void bench(int32_t depth);
+
+// Hit rates of the pawn hash tables and eval caches of all search threads,
+// and how often quiescence could stand pat on the lazy eval
+void print_cache_stats();
+void reset_cache_stats();
+
+// SEE microbenchmark over every capture of the bench positions
+void see_bench(int32_t iterations);
+
+// HCE microbenchmark, times evaluate() with the attack scoring this build
+// was compiled for
+void eval_bench(int32_t iterations);
+
+// Hammers a small shared transposition table from several threads and
+// checks that no probe returns data stored for another position
+void tt_stress(int32_t thread_count, int64_t operations);
\ No newline at end of file
@@ -446,149 +446,3 @@ bool is_white_passed_pawn(int32_t square, uint64_t black_pawns) {
 bool is_black_passed_pawn(int32_t square, uint64_t white_pawns) {
     return (BLACK_PASSED_MASK[square] & white_pawns) == 0;
 }
-
-// Get the pawn key for the current position
-uint64_t get_pawn_key(const Board &board){
-    uint64_t pawn_key = 0ull;
-    uint64_t wp = board.pieces(PieceType::PAWN, Color::WHITE).getBits();
-    uint64_t bp = board.pieces(PieceType::PAWN, Color::BLACK).getBits();
-    while (wp){
-        int32_t sq = pop_lsb(wp);
-        pawn_key ^= PAWN_RANDOMS[0][sq];
-    }
-    while (bp){
-        int32_t sq = pop_lsb(bp);
-        pawn_key ^= PAWN_RANDOMS[1][sq];
-    }
-    return pawn_key;
-}
-
-// Get the non-pawn key for the current position
-uint64_t get_non_pawn_key(const Board &board){
-    uint64_t non_pawn_key = 0ull;
-    uint64_t wn = board.pieces(chess::PieceType::KNIGHT, chess::Color::WHITE).getBits();
-    uint64_t wb = board.pieces(chess::PieceType::BISHOP, chess::Color::WHITE).getBits();
-    uint64_t wr = board.pieces(chess::PieceType::ROOK, chess::Color::WHITE).getBits();
-    uint64_t wq = board.pieces(chess::PieceType::QUEEN, chess::Color::WHITE).getBits();
-    uint64_t wk = board.pieces(chess::PieceType::KING, chess::Color::WHITE).getBits();
-    uint64_t bn = board.pieces(chess::PieceType::KNIGHT, chess::Color::BLACK).getBits();
-    uint64_t bb = board.pieces(chess::PieceType::BISHOP, chess::Color::BLACK).getBits();
-    uint64_t br = board.pieces(chess::PieceType::ROOK, chess::Color::BLACK).getBits();
-    uint64_t bq = board.pieces(chess::PieceType::QUEEN, chess::Color::BLACK).getBits();
-    uint64_t bk = board.pieces(chess::PieceType::KING, chess::Color::BLACK).getBits();
-
-    // Knights
-    while (wn){
-        int32_t sq = pop_lsb(wn);
-        non_pawn_key ^= KNIGHT_RANDOMS[0][sq];
-    }
-    while (bn){
-        int32_t sq = pop_lsb(bn);
-        non_pawn_key ^= KNIGHT_RANDOMS[1][sq];
-    }
-
-    // Bishops
-    while (wb){
-        int32_t sq = pop_lsb(wb);
-        non_pawn_key ^= BISHOP_RANDOMS[0][sq];
-    }
-    while (bb){
-        int32_t sq = pop_lsb(bb);
-        non_pawn_key ^= BISHOP_RANDOMS[1][sq];
-    }
-
-    // Rooks
-    while (wr){
-        int32_t sq = pop_lsb(wr);
-        non_pawn_key ^= ROOK_RANDOMS[0][sq];
-    }
-    while (br){
-        int32_t sq = pop_lsb(br);
-        non_pawn_key ^= ROOK_RANDOMS[1][sq];
-    }
-
-    // Queens
-    while (wq){
-        int32_t sq = pop_lsb(wq);
-        non_pawn_key ^= QUEEN_RANDOMS[0][sq];
-    }
-    while (bq){
-        int32_t sq = pop_lsb(bq);
-        non_pawn_key ^= QUEEN_RANDOMS[1][sq];
-    }
-
-    // Kings
-    while (wk){
-        int32_t sq = pop_lsb(wk);
-        non_pawn_key ^= KING_RANDOMS[0][sq];
-    }
-    while (bk){
-        int32_t sq = pop_lsb(bk);
-        non_pawn_key ^= KING_RANDOMS[1][sq];
-    }
-
-    return non_pawn_key;
-}
-
-// Get the minors key for the current position
-uint64_t get_minors_key(const Board &board){
-    uint64_t minors_key = 0ull;
-    uint64_t wn = board.pieces(chess::PieceType::KNIGHT, chess::Color::WHITE).getBits();
-    uint64_t wb = board.pieces(chess::PieceType::BISHOP, chess::Color::WHITE).getBits();
-    uint64_t bn = board.pieces(chess::PieceType::KNIGHT, chess::Color::BLACK).getBits();
-    uint64_t bb = board.pieces(chess::PieceType::BISHOP, chess::Color::BLACK).getBits();
-
-    // Knights
-    while (wn){
-        int32_t sq = pop_lsb(wn);
-        minors_key ^= KNIGHT_RANDOMS[0][sq];
-    }
-    while (bn){
-        int32_t sq = pop_lsb(bn);
-        minors_key ^= KNIGHT_RANDOMS[1][sq];
-    }
-
-    // Bishops
-    while (wb){
-        int32_t sq = pop_lsb(wb);
-        minors_key ^= BISHOP_RANDOMS[0][sq];
-    }
-    while (bb){
-        int32_t sq = pop_lsb(bb);
-        minors_key ^= BISHOP_RANDOMS[1][sq];
-    }
-
-    return minors_key;
-}
-
-
-// Get the majors key for the current position
-uint64_t get_majors_key(const Board &board){
-    uint64_t majors_key = 0ull;
-    uint64_t wr = board.pieces(chess::PieceType::ROOK, chess::Color::WHITE).getBits();
-    uint64_t wq = board.pieces(chess::PieceType::QUEEN, chess::Color::WHITE).getBits();
-    uint64_t br = board.pieces(chess::PieceType::ROOK, chess::Color::BLACK).getBits();
-    uint64_t bq = board.pieces(chess::PieceType::QUEEN, chess::Color::BLACK).getBits();
-
-    // Rooks
-    while (wr){
-        int32_t sq = pop_lsb(wr);
-        majors_key ^= ROOK_RANDOMS[0][sq];
-    }
-    while (br){
-        int32_t sq = pop_lsb(br);
-        majors_key ^= ROOK_RANDOMS[1][sq];
-    }
-
-    // Queens
-    while (wq){
-        int32_t sq = pop_lsb(wq);
-        majors_key ^= QUEEN_RANDOMS[0][sq];
-    }
-    while (bq){
-        int32_t sq = pop_lsb(bq);
-        majors_key ^= QUEEN_RANDOMS[1][sq];
-    }
-
-    return majors_key;
-}
\ No newline at end of file
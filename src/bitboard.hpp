@@ -1,6 +1,8 @@
 #pragma once
 #include <cstdint>
 
+#include "chess.hpp"
+
 extern const uint64_t WHITE_PASSED_MASK[64];
 extern const uint64_t BLACK_PASSED_MASK[64];
 extern const uint64_t OUTER_2_SQ_RING_MASK[64];
@@ -12,9 +14,54 @@ extern const uint64_t NOT_KINGSIDE_HALF_MASK[64];
 extern const uint64_t LEFT_RIGHT_COLUMN_MASK[64];
 extern const uint64_t WHITE_LEFT_MASK[64];
 extern const uint64_t BLACK_LEFT_MASK[64];
+
+// Zobrist randoms of each piece type [color][square], [0] -> white
+extern const uint64_t PAWN_RANDOMS[2][64];
+extern const uint64_t KNIGHT_RANDOMS[2][64];
+extern const uint64_t BISHOP_RANDOMS[2][64];
+extern const uint64_t ROOK_RANDOMS[2][64];
+extern const uint64_t QUEEN_RANDOMS[2][64];
+extern const uint64_t KING_RANDOMS[2][64];
+
 bool is_white_passed_pawn(int32_t square, uint64_t black_pawns);
 bool is_black_passed_pawn(int32_t square, uint64_t white_pawns);
-uint64_t get_pawn_key(const chess::Board &board);
-uint64_t get_non_pawn_key(const chess::Board &board);
-uint64_t get_minors_key(const chess::Board &board);
-uint64_t get_majors_key(const chess::Board &board);
\ No newline at end of file
+// Zobrist keys of parts of the position, for the pawn hash table and the
+// correction histories. Search keeps these up to date move by move, see
+// EvalAccumulator
+struct CorrectionKeys {
+    uint64_t pawn = 0ull;
+    uint64_t non_pawn = 0ull; // Everything but pawns, kings included
+    uint64_t minors = 0ull;
+    uint64_t majors = 0ull;
+};
+
+// Adds or removes (XOR either way) a piece on sq from the keys
+inline void toggle_piece(CorrectionKeys &keys, chess::Piece piece, int32_t sq) {
+    int32_t side = static_cast<int32_t>(piece.color());
+    switch (static_cast<int32_t>(piece.type())) {
+        case 0:
+            keys.pawn ^= PAWN_RANDOMS[side][sq];
+            break;
+        case 1:
+            keys.non_pawn ^= KNIGHT_RANDOMS[side][sq];
+            keys.minors ^= KNIGHT_RANDOMS[side][sq];
+            break;
+        case 2:
+            keys.non_pawn ^= BISHOP_RANDOMS[side][sq];
+            keys.minors ^= BISHOP_RANDOMS[side][sq];
+            break;
+        case 3:
+            keys.non_pawn ^= ROOK_RANDOMS[side][sq];
+            keys.majors ^= ROOK_RANDOMS[side][sq];
+            break;
+        case 4:
+            keys.non_pawn ^= QUEEN_RANDOMS[side][sq];
+            keys.majors ^= QUEEN_RANDOMS[side][sq];
+            break;
+        case 5:
+            keys.non_pawn ^= KING_RANDOMS[side][sq];
+            break;
+        default:
+            break;
+    }
+}
\ No newline at end of file
@@ -2,8 +2,9 @@
 
 // Basics
 SearchParam tt_size("Hash", 64, 1, 16384, 1);
-SearchParam threads("Threads", 1, 1, 1, 1);
+SearchParam threads("Threads", 1, 1, 256, 1);
 SearchParam move_overhead("MoveOverhead", 0, 0, 10000, 1);
+SearchParam eval_cache_size("EvalCache", 1, 0, 256, 1);
 
 // SPSA (https://kelseyde.pythonanywhere.com/tune/969/)
 /*
@@ -92,6 +93,8 @@ SearchParam see_queen("SEEQueen", 955, 800, 1200, 15);
 
 SearchParam delta_pruning_pawn_bonus("DeltaPruningPawnBonus", 140, 80, 200, 20);
 
+SearchParam lazy_eval_margin("LazyEvalMargin", 300, 150, 600, 30);
+
 SearchParam tempo("Tempo", 2, 0, 20, 2);
 
 SearchParam soft_tm_ratio("SoftTMRatio", 27, 5, 50, 8);
@@ -53,7 +53,7 @@ inline void print_open_bench_config()
 {
     for (const auto& param : all_params)
     {
-        if (param->name == "Threads" || param->name == "Hash" || param->name == "MoveOverhead")
+        if (param->name == "Threads" || param->name == "Hash" || param->name == "MoveOverhead" || param->name == "EvalCache")
             continue;
 
         std::cout << param->name << ", int, "
@@ -69,6 +69,7 @@ inline void print_open_bench_config()
 extern SearchParam tt_size;
 extern SearchParam threads;
 extern SearchParam move_overhead;
+extern SearchParam eval_cache_size;
 extern SearchParam reverse_futility_margin;
 extern SearchParam null_move_depth;
 extern SearchParam null_move_base;
@@ -100,6 +101,7 @@ extern SearchParam see_bishop;
 extern SearchParam see_rook;
 extern SearchParam see_queen;
 extern SearchParam delta_pruning_pawn_bonus;
+extern SearchParam lazy_eval_margin;
 extern SearchParam tempo;
 extern SearchParam soft_tm_ratio;
 extern SearchParam hard_tm_ratio;
@@ -7,6 +7,7 @@
 #include "eval.hpp"
 #include "defaults.hpp"
 #include "bitboard.hpp"
+#include "attack_scores.hpp"
 
 using namespace chess;
 using namespace std;
@@ -257,186 +258,290 @@ const int32_t game_phase_increment[6] = {
   0, 1, 1, 2, 4, 0
 };
 
-// This is our HCE evaluation function. 
-int32_t evaluate(const chess::Board& board) {
-
-    int32_t eval_array[2] = {0,0};
-    int32_t phase = 0;
-
-    // Get all piece bitboards for efficient looping
-    chess::Bitboard wp = board.pieces(chess::PieceType::PAWN, chess::Color::WHITE);
-    chess::Bitboard wn = board.pieces(chess::PieceType::KNIGHT, chess::Color::WHITE);
-    chess::Bitboard wb = board.pieces(chess::PieceType::BISHOP, chess::Color::WHITE);
-    chess::Bitboard wr = board.pieces(chess::PieceType::ROOK, chess::Color::WHITE);
-    chess::Bitboard wq = board.pieces(chess::PieceType::QUEEN, chess::Color::WHITE);
-    chess::Bitboard wk = board.pieces(chess::PieceType::KING, chess::Color::WHITE);
-    chess::Bitboard bp = board.pieces(chess::PieceType::PAWN, chess::Color::BLACK);
-    chess::Bitboard bn = board.pieces(chess::PieceType::KNIGHT, chess::Color::BLACK);
-    chess::Bitboard bb = board.pieces(chess::PieceType::BISHOP, chess::Color::BLACK);
-    chess::Bitboard br = board.pieces(chess::PieceType::ROOK, chess::Color::BLACK);
-    chess::Bitboard bq = board.pieces(chess::PieceType::QUEEN, chess::Color::BLACK);
-    chess::Bitboard bk = board.pieces(chess::PieceType::KING, chess::Color::BLACK);
-    chess::Bitboard all[] = {wp,wn,wb,wr,wq,wk,bp,bn,bb,br,bq,bk};
-
-    int32_t whiteKingSq = board.kingSq(chess::Color::WHITE).index();
-    int32_t blackKingSq = board.kingSq(chess::Color::BLACK).index();
-
-    uint64_t not_kingside_w_mask = NOT_KINGSIDE_HALF_MASK[whiteKingSq];
-    uint64_t not_kingside_b_mask = NOT_KINGSIDE_HALF_MASK[blackKingSq];
-
-    uint64_t white_king_2_sq_mask = OUTER_2_SQ_RING_MASK[whiteKingSq];
-    uint64_t black_king_2_sq_mask = OUTER_2_SQ_RING_MASK[blackKingSq];
-    uint64_t white_king_inner_sq_mask = chess::attacks::king(whiteKingSq).getBits();
-    uint64_t black_king_inner_sq_mask = chess::attacks::king(blackKingSq).getBits();
-
-    // Rooks on semi open files
-    int32_t num_w_rooks_on_semi_op_file = 0;
-    int32_t num_b_rooks_on_semi_op_file = 0;
-
-    // A fast way of getting all the pieces 
-    for (int32_t i = 0; i < 12; i++){        
-        chess::Bitboard curr_bb = all[i];
-        while (!curr_bb.empty()) {
-            int32_t sq = curr_bb.pop();
-            bool is_white = i < 6;
-            int32_t j = is_white ? i : i-6;
-
-            // Phase for tapered evaluation
-            phase += game_phase_increment[j];
-
-            // Piece square tables
-            eval_array[is_white ? 0 : 1] += PSQT[j][is_white ? sq ^ 56 : sq];
-
-            uint64_t attacks_bb = 0ull;
-
-            // Mobilities for knight - queen, and king virtual mobility
-            // King Zone
-            if (j > 0){
-                int32_t attacks = 0;
-                switch (j)
-                {
-                    // knights
-                    case 1:
-                        attacks_bb = chess::attacks::knight(static_cast<chess::Square>(sq)).getBits();
-                        attacks = __builtin_popcountll(attacks_bb);
-                        break;
-                    // bishops
-                    case 2:
-                        attacks_bb = chess::attacks::bishop(static_cast<chess::Square>(sq), board.occ()).getBits();
-                        attacks = __builtin_popcountll(attacks_bb);
-                        break;
-                    // rooks
-                    case 3:
-                        // Rook on semi-open file
-                        if ((is_white ? (WHITE_AHEAD_MASK[sq] & wp) : (BLACK_AHEAD_MASK[sq] & bp)) == 0ull){
-                            if (is_white) num_w_rooks_on_semi_op_file++;
-                            else num_b_rooks_on_semi_op_file++;
-                        }
-
-                        attacks_bb = chess::attacks::rook(static_cast<chess::Square>(sq), board.occ()).getBits();
-                        attacks = __builtin_popcountll(attacks_bb);
-                        break;
-                    // queens
-                    case 4:
-                        attacks_bb = chess::attacks::queen(static_cast<chess::Square>(sq), board.occ()).getBits();
-                        attacks = __builtin_popcountll(attacks_bb);
-                        break;
-                    // King Virtual Mobility
-                    case 5:
-                        attacks = chess::attacks::queen(static_cast<chess::Square>(sq), board.occ()).count();
-                        break;
-
-                    default:
-                        break;
-                }
+// Mobility of a knight, bishop, rook and queen that attacks a typical
+// number of squares, for lazy_evaluate
+const int32_t typical_mobility[4] = {
+    mobilities[0][4], mobilities[1][7], mobilities[2][7], mobilities[3][14],
+};
 
-                // Mobilities
-                eval_array[is_white ? 0 : 1] += mobilities[j-1][attacks];
-                
-                // Non king non pawn pieces
-                if (j < 5){
-                    
-                    // King zone attacks
-                    eval_array[is_white ? 0 : 1] += inner_king_zone_attacks[j-1]  * __builtin_popcountll((is_white ? black_king_inner_sq_mask : white_king_inner_sq_mask) & attacks_bb); 
-                    eval_array[is_white ? 0 : 1] += outer_king_zone_attacks[j-1]  * __builtin_popcountll((is_white ? black_king_2_sq_mask : white_king_2_sq_mask) & attacks_bb); 
-                }
-            }
+// Evaluation tapering, that is, interpolating mg and eg values depending on how many pieces
+// there are on the board. See here for more information: https://www.chessprogramming.org/Tapered_Eval
+inline int32_t taper(int32_t score, int32_t phase) {
+    int32_t mg_score = (int32_t)unpack_mg(score);
+    int32_t eg_score = (int32_t)unpack_eg(score);
+    int32_t mg_phase = phase;
+    if (mg_phase > 24) mg_phase = 24;
+    int32_t eg_phase = 24 - mg_phase; 
+    return (mg_score * mg_phase + eg_score * eg_phase) / 24;
+}
 
-            // Pawns
-            else {
-                // Doubled pawns
-                // Note that for pawns to be considered "doubled", they need not be directly in front
-                // of another pawn
-                uint64_t front_mask = is_white ? WHITE_AHEAD_MASK[sq] : BLACK_AHEAD_MASK[sq];
-                uint64_t our_pawn_bb = is_white ? wp.getBits() : bp.getBits();
-                if (front_mask & our_pawn_bb){
-                    eval_array[is_white ? 0 : 1] += doubled_pawn_penalty[is_white ? 7 - sq % 8 : sq % 8];
-                }
+// Pawn structure terms (doubled, passed, isolated, phalanx and pawn storm)
+// of both sides. These only depend on where the pawns are, so they are
+// cached in the pawn hash table. Pawn storm also depends on which half of
+// the board the king is on, so we score it for both halves
+void evaluate_pawns(uint64_t wp, uint64_t bp, PawnEntry &entry) {
+    entry.scores[0] = entry.scores[1] = 0;
+    entry.storm[0][0] = entry.storm[0][1] = entry.storm[1][0] = entry.storm[1][1] = 0;
+    entry.passed[0] = entry.passed[1] = 0ull;
+
+    for (int32_t side = 0; side < 2; side++){
+        bool is_white = side == 0;
+        uint64_t our_pawn_bb = is_white ? wp : bp;
+        uint64_t pawns = our_pawn_bb;
+
+        while (pawns){
+            int32_t sq = __builtin_ctzll(pawns);
+            pawns &= pawns - 1;
+
+            // Doubled pawns
+            // Note that for pawns to be considered "doubled", they need not be directly in front
+            // of another pawn
+            uint64_t front_mask = is_white ? WHITE_AHEAD_MASK[sq] : BLACK_AHEAD_MASK[sq];
+            if (front_mask & our_pawn_bb){
+                entry.scores[side] += doubled_pawn_penalty[is_white ? 7 - sq % 8 : sq % 8];
+            }
 
-                // Passed pawn
-                if (is_white ? is_white_passed_pawn(sq, bp.getBits()): is_black_passed_pawn(sq, wp.getBits())){
-                    eval_array[is_white ? 0 : 1] += passed_pawns[is_white ? sq ^ 56 : sq];
-                }
+            // Passed pawn
+            if (is_white ? is_white_passed_pawn(sq, bp): is_black_passed_pawn(sq, wp)){
+                entry.scores[side] += passed_pawns[is_white ? sq ^ 56 : sq];
+                entry.passed[side] |= 1ull << sq;
+            }
 
-                // Pawn storm
-                if (is_white ? (not_kingside_w_mask & (1ull << sq)) : (not_kingside_b_mask & (1ull << sq))){
-                    eval_array[is_white ? 0 : 1] += pawn_storm[is_white ? sq ^ 56 : sq];
+            // Pawn storm, for a king on files a-d and e-h
+            for (int32_t king_half = 0; king_half < 2; king_half++){
+                if (NOT_KINGSIDE_HALF_MASK[king_half * 4] & (1ull << sq)){
+                    entry.storm[side][king_half] += pawn_storm[is_white ? sq ^ 56 : sq];
                 }
+            }
 
-                // Isolated pawn
-                if ((LEFT_RIGHT_COLUMN_MASK[sq] & (is_white ? wp.getBits() : bp.getBits())) == 0ull){
-                    eval_array[is_white ? 0 : 1] += isolated_pawns[is_white ? sq ^ 56 : sq];
-                }
+            // Isolated pawn
+            if ((LEFT_RIGHT_COLUMN_MASK[sq] & our_pawn_bb) == 0ull){
+                entry.scores[side] += isolated_pawns[is_white ? sq ^ 56 : sq];
+            }
 
-                // Phalanx pawns
-                if (is_white ? (WHITE_LEFT_MASK[sq] & wp) : (BLACK_LEFT_MASK[sq] & bp)){
-                    eval_array[is_white ? 0 : 1] += phalanx_pawns[is_white ? sq / 8 : 7 - sq / 8];
-                }
+            // Phalanx pawns
+            if (is_white ? (WHITE_LEFT_MASK[sq] & wp) : (BLACK_LEFT_MASK[sq] & bp)){
+                entry.scores[side] += phalanx_pawns[is_white ? sq / 8 : 7 - sq / 8];
             }
+        }
+    }
+}
+
+// [0] -> white, [1] -> black. Compared instead of cast, so Piece::NONE
+// (color -1) can't index outside our [2] arrays
+inline int32_t piece_side(Piece piece){
+    return piece.color() == Color::WHITE ? 0 : 1;
+}
+
+inline void accumulator_add(EvalAccumulator &acc, nnue::Accumulator *nnue_acc, Piece piece, int32_t sq){
+    if (nnue_acc)
+        nnue::add_piece(*nnue_acc, piece, sq);
+
+    int32_t side = piece_side(piece);
+    int32_t j = static_cast<int32_t>(piece.type());
+    acc.psqt[side] += PSQT[j][side == 0 ? sq ^ 56 : sq];
+    acc.phase[side] += game_phase_increment[j];
+    toggle_piece(acc.keys, piece, sq);
+}
+
+inline void accumulator_remove(EvalAccumulator &acc, nnue::Accumulator *nnue_acc, Piece piece, int32_t sq){
+    if (nnue_acc)
+        nnue::remove_piece(*nnue_acc, piece, sq);
+
+    int32_t side = piece_side(piece);
+    int32_t j = static_cast<int32_t>(piece.type());
+    acc.psqt[side] -= PSQT[j][side == 0 ? sq ^ 56 : sq];
+    acc.phase[side] -= game_phase_increment[j];
+    toggle_piece(acc.keys, piece, sq);
+}
+
+EvalAccumulator accumulator_from_board(const chess::Board& board){
+    EvalAccumulator acc{};
+    Bitboard occ = board.occ();
+    while (!occ.empty()){
+        int32_t sq = occ.pop();
+        accumulator_add(acc, nullptr, board.at(static_cast<Square>(sq)), sq);
+    }
+    return acc;
+}
+
+// Mirrors what Board::makeMove does with the pieces
+void accumulator_make_move(EvalAccumulator& acc, nnue::Accumulator* nnue_acc, const chess::Board& board, chess::Move move){
+    int32_t from = move.from().index();
+    int32_t to = move.to().index();
+    Piece piece = board.at(move.from());
+    Color us = board.sideToMove();
+
+    if (move.typeOf() == Move::CASTLING){
+        bool king_side = move.to() > move.from();
+        accumulator_remove(acc, nnue_acc, piece, from);
+        accumulator_remove(acc, nnue_acc, Piece(PieceType::ROOK, us), to);
+        accumulator_add(acc, nnue_acc, piece, Square::castling_king_square(king_side, us).index());
+        accumulator_add(acc, nnue_acc, Piece(PieceType::ROOK, us), Square::castling_rook_square(king_side, us).index());
+        return;
+    }
+
+    Piece captured = board.at(move.to());
+    if (captured != Piece::NONE)
+        accumulator_remove(acc, nnue_acc, captured, to);
 
-            // Actual king attacks because we let attacks bb for king be a queen attacks bb
-            // for virtual mobility above
-            if (j == 5) attacks_bb = chess::attacks::king(static_cast<chess::Square>(sq)).getBits();
-
-            // Threats
-            int32_t num_pawn_attacks = is_white ? __builtin_popcountll(attacks_bb & bp.getBits()) : __builtin_popcountll(attacks_bb & wp.getBits());
-            int32_t num_knight_attacks = is_white ? __builtin_popcountll(attacks_bb & bn.getBits()) : __builtin_popcountll(attacks_bb & wn.getBits());
-            int32_t num_bishop_attacks = is_white ? __builtin_popcountll(attacks_bb & bb.getBits()) : __builtin_popcountll(attacks_bb & wb.getBits());
-            int32_t num_rook_attacks = is_white ? __builtin_popcountll(attacks_bb & br.getBits()) : __builtin_popcountll(attacks_bb & wr.getBits());
-            int32_t num_queen_attacks = is_white ? __builtin_popcountll(attacks_bb & bq.getBits()) : __builtin_popcountll(attacks_bb & wq.getBits());
-            int32_t num_king_attacks = is_white ? __builtin_popcountll(attacks_bb & bk.getBits()) : __builtin_popcountll(attacks_bb & wk.getBits());
-
-            eval_array[is_white ? 0 : 1] += threats[j][0] * num_pawn_attacks;
-            eval_array[is_white ? 0 : 1] += threats[j][1] * num_knight_attacks;
-            eval_array[is_white ? 0 : 1] += threats[j][2] * num_bishop_attacks;
-            eval_array[is_white ? 0 : 1] += threats[j][3] * num_rook_attacks;
-            eval_array[is_white ? 0 : 1] += threats[j][4] * num_queen_attacks;
-            eval_array[is_white ? 0 : 1] += threats[j][5] * num_king_attacks;
+    accumulator_remove(acc, nnue_acc, piece, from);
+    accumulator_add(acc, nnue_acc, move.typeOf() == Move::PROMOTION ? Piece(move.promotionType(), us) : piece, to);
 
+    if (move.typeOf() == Move::ENPASSANT)
+        accumulator_remove(acc, nnue_acc, Piece(PieceType::PAWN, ~us), move.to().ep_square().index());
+}
+
+int32_t evaluate(const chess::Board& board, PawnHashTable* pawn_table) {
+    AttackInfo info;
+    compute_piece_attacks(board, info);
+    return evaluate(board, accumulator_from_board(board), info, pawn_table);
+}
+
+// Threat and king zone weights of an attack by each piece type, in the
+// target order of an AttackBatch. Kings don't score king zone attacks
+struct AttackWeights {
+    int32_t values[6][ATTACK_TARGETS]{};
+
+    constexpr AttackWeights() {
+        for (int32_t piece = 0; piece < 6; piece++) {
+            for (int32_t k = 0; k < 6; k++)
+                values[piece][k] = threats[piece][k];
+            if (piece >= 1 && piece <= 4) {
+                values[piece][6] = inner_king_zone_attacks[piece - 1];
+                values[piece][7] = outer_king_zone_attacks[piece - 1];
+            }
+        }
+    }
+};
+
+static constexpr AttackWeights attack_weights{};
+
+// Mobility of all of one side's knights, bishops, rooks or queens (Piece 1
+// to 4), their attacks go into the batch for threats and king zone attacks.
+// Templated on the side and piece type so every white/black and piece
+// specific choice is made at compile time
+template <Color::underlying Us, int32_t Piece>
+inline int32_t evaluate_piece_type(const uint64_t (&pieces)[2][6], const AttackInfo& info, AttackBatch& batch, int32_t& rooks_on_semi_open_file) {
+    constexpr int32_t us = Us == Color::WHITE ? 0 : 1;
+    int32_t score = 0;
+
+    uint64_t bb = pieces[us][Piece];
+    while (bb) {
+        int32_t sq = __builtin_ctzll(bb);
+        bb &= bb - 1;
+
+        uint64_t attacks_bb = info.piece_attacks[sq];
+
+        // Rook on semi-open file
+        if constexpr (Piece == 3) {
+            const uint64_t* ahead_mask = Us == Color::WHITE ? WHITE_AHEAD_MASK : BLACK_AHEAD_MASK;
+            if ((ahead_mask[sq] & pieces[us][0]) == 0ull)
+                rooks_on_semi_open_file++;
         }
 
+        // Mobilities
+        score += mobilities[Piece - 1][__builtin_popcountll(attacks_bb)];
+
+        batch.add(attacks_bb, attack_weights.values[Piece]);
     }
 
+    return score;
+}
+
+// Every term of one side that isn't in the accumulator or the pawn hash
+// table, packed S(mg, eg) from Us's point of view
+template <Color::underlying Us>
+inline int32_t evaluate_side(const chess::Board& board, const uint64_t (&pieces)[2][6], const AttackInfo& info, const int32_t (&king_sq)[2]) {
+    constexpr int32_t us = Us == Color::WHITE ? 0 : 1;
+    constexpr int32_t them = us ^ 1;
+    int32_t score = 0;
+
+    const uint64_t targets[ATTACK_TARGETS] = {
+        pieces[them][0], pieces[them][1], pieces[them][2], pieces[them][3], pieces[them][4], pieces[them][5],
+        chess::attacks::king(king_sq[them]).getBits(), OUTER_2_SQ_RING_MASK[king_sq[them]]
+    };
+    AttackBatch batch(targets);
+
+    int32_t rooks_on_semi_open_file = 0;
+    score += evaluate_piece_type<Us, 1>(pieces, info, batch, rooks_on_semi_open_file);
+    score += evaluate_piece_type<Us, 2>(pieces, info, batch, rooks_on_semi_open_file);
+    score += evaluate_piece_type<Us, 3>(pieces, info, batch, rooks_on_semi_open_file);
+    score += evaluate_piece_type<Us, 4>(pieces, info, batch, rooks_on_semi_open_file);
+
+    // King virtual mobility, the king moving like a queen
+    score += mobilities[4][chess::attacks::queen(static_cast<chess::Square>(king_sq[us]), board.occ()).count()];
+
+    // King threats
+    batch.add<6>(info.piece_attacks[king_sq[us]], attack_weights.values[5]);
+
+    // Threats and king zone attacks
+    score += batch.score();
+
     // Bishop Pair
-    if (wb.count() == 2) eval_array[0] += bishop_pair; 
-    if (bb.count() == 2) eval_array[1] += bishop_pair; 
+    if (__builtin_popcountll(pieces[us][2]) == 2) score += bishop_pair;
 
     // Rooks on semi-open files
-    if (num_w_rooks_on_semi_op_file == 1) eval_array[0] += rook_semi_open[0];
-    if (num_w_rooks_on_semi_op_file == 2) eval_array[0] += rook_semi_open[1];
-    if (num_b_rooks_on_semi_op_file == 1) eval_array[1] += rook_semi_open[0];
-    if (num_b_rooks_on_semi_op_file == 2) eval_array[1] += rook_semi_open[1];
+    if (rooks_on_semi_open_file == 1) score += rook_semi_open[0];
+    if (rooks_on_semi_open_file == 2) score += rook_semi_open[1];
 
+    return score;
+}
+
+// This is our HCE evaluation function. Material, piece square tables and
+// phase come from the accumulator, pawn structure from the pawn hash table
+// and the piece terms of each side from evaluate_side
+int32_t evaluate(const chess::Board& board, const EvalAccumulator& acc, const AttackInfo& info, PawnHashTable* pawn_table) {
+
+    // Piece bitboards [side][piece type]
+    uint64_t pieces[2][6];
+    for (int32_t j = 0; j < 6; j++) {
+        pieces[0][j] = board.pieces(static_cast<PieceType::underlying>(j), Color::WHITE).getBits();
+        pieces[1][j] = board.pieces(static_cast<PieceType::underlying>(j), Color::BLACK).getBits();
+    }
+
+    int32_t king_sq[2] = { board.kingSq(Color::WHITE).index(), board.kingSq(Color::BLACK).index() };
+
+    // Pawn structure, from the pawn hash table if we have seen these pawns before
+    PawnEntry local_entry{};
+    PawnEntry *pawn_entry = &local_entry;
+    if (pawn_table){
+        uint64_t pawn_key = acc.keys.pawn;
+        pawn_entry = &pawn_table->entry(pawn_key);
+        pawn_table->probes++;
+        if (pawn_entry->key == pawn_key)
+            pawn_table->hits++;
+        else {
+            evaluate_pawns(pieces[0][0], pieces[1][0], *pawn_entry);
+            pawn_entry->key = pawn_key;
+        }
+    }
+    else
+        evaluate_pawns(pieces[0][0], pieces[1][0], local_entry);
+
+    int32_t eval_array[2] = {
+        acc.psqt[0] + pawn_entry->scores[0] + pawn_entry->storm[0][(king_sq[0] & 7) >= 4] + evaluate_side<Color::WHITE>(board, pieces, info, king_sq),
+        acc.psqt[1] + pawn_entry->scores[1] + pawn_entry->storm[1][(king_sq[1] & 7) >= 4] + evaluate_side<Color::BLACK>(board, pieces, info, king_sq)
+    };
+    int32_t phase = acc.phase[0] + acc.phase[1];
 
     int32_t stm = board.sideToMove() == Color::WHITE ? 0 : 1;
-    int32_t score = eval_array[stm] - eval_array[stm^1];
-    int32_t mg_score = (int32_t)unpack_mg(score);
-    int32_t eg_score = (int32_t)unpack_eg(score);
-    int32_t mg_phase = phase;
-    if (mg_phase > 24) mg_phase = 24;
-    int32_t eg_phase = 24 - mg_phase; 
+    return tempo.current + taper(eval_array[stm] - eval_array[stm^1], phase);
+}
+
+// Material and piece square tables from the accumulator, plus the mobility
+// of each piece with a typical number of attacked squares since the
+// mobility tables hold a good part of every piece's value. Everything else
+// is left out, so this is only an estimate of evaluate()
+int32_t lazy_evaluate(const chess::Board& board, const EvalAccumulator& acc) {
+    int32_t eval_array[2] = { acc.psqt[0], acc.psqt[1] };
+    for (int32_t side = 0; side < 2; side++) {
+        Color color = side == 0 ? Color::WHITE : Color::BLACK;
+        for (int32_t j = 1; j <= 4; j++)
+            eval_array[side] += typical_mobility[j - 1] * board.pieces(static_cast<PieceType::underlying>(j), color).count();
+    }
+    int32_t phase = acc.phase[0] + acc.phase[1];
 
-    // Evaluation tapering, that is, interpolating mg and eg values depending on how many pieces
-    // there are on the board. See here for more information: https://www.chessprogramming.org/Tapered_Eval
-    return tempo.current + ((mg_score * mg_phase + eg_score * eg_phase) / 24);
+    int32_t stm = board.sideToMove() == Color::WHITE ? 0 : 1;
+    return tempo.current + taper(eval_array[stm] - eval_array[stm^1], phase);
 }
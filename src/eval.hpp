@@ -1,8 +1,42 @@
 #pragma once
 #include <stdint.h>
 
+#include "chess.hpp"
 #include "packing.hpp"
+#include "pawn_hash.hpp"
+#include "bitboard.hpp"
+#include "nnue.hpp"
+#include "attack_info.hpp"
+
+// Material + piece square table score and game phase of each side, plus the
+// pawn/non-pawn/minor/major keys. These only change with the pieces that
+// move, so search keeps them up to date move by move instead of
+// recomputing them in every evaluation
+struct EvalAccumulator {
+    // Packed S(mg, eg), [0] -> white, [1] -> black
+    int32_t psqt[2]{};
+    int32_t phase[2]{};
+
+    CorrectionKeys keys{};
+};
+
+// Sums up the accumulator of a position from scratch
+EvalAccumulator accumulator_from_board(const chess::Board& board);
+
+// Updates acc, the accumulator of board, to the position after move, and
+// nnue_acc as well unless it's null. Must be called before the move is made
+// on the board
+void accumulator_make_move(EvalAccumulator& acc, nnue::Accumulator* nnue_acc, const chess::Board& board, chess::Move move);
 
 // Tapered static evaluation function given a board position
-// returns score relative to player
-int32_t evaluate(const chess::Board& board);
\ No newline at end of file
+// returns score relative to player. Pawn structure terms are cached in
+// pawn_table when given. info must have its piece attacks computed
+int32_t evaluate(const chess::Board& board, const EvalAccumulator& acc, const AttackInfo& info, PawnHashTable* pawn_table = nullptr);
+
+// Same as above, computing the accumulator and attacks from scratch
+int32_t evaluate(const chess::Board& board, PawnHashTable* pawn_table = nullptr);
+
+// Cheap estimate of evaluate() from material and piece square tables only,
+// for when the position is far enough outside the search window that the
+// other terms can't matter
+int32_t lazy_evaluate(const chess::Board& board, const EvalAccumulator& acc);
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <cstdint>
+#include <algorithm>
+#include <vector>
+
+// Raw static evals of positions we evaluated recently, so transpositions
+// the TT no longer holds don't have to be evaluated again. Each search
+// thread owns one, direct mapped and keyed by the full zobrist key
+struct EvalCacheEntry {
+    uint64_t key = 0;
+    int32_t eval = 0;
+};
+
+const int32_t EVAL_CACHE_DEFAULT_SIZE = 1;
+
+struct EvalCache {
+    std::vector<EvalCacheEntry> entries{};
+    uint64_t mask = 0;
+
+    // Statistics for bench and cachestats
+    int64_t probes = 0;
+    int64_t hits = 0;
+
+    EvalCache() {
+        resize(EVAL_CACHE_DEFAULT_SIZE);
+    }
+
+    // Rounded down to a power of 2 entries, 0 MB disables the cache
+    void resize(size_t mb) {
+        size_t count = mb * 1024 * 1024 / sizeof(EvalCacheEntry);
+        while (count & (count - 1))
+            count &= count - 1;
+        entries.assign(count, EvalCacheEntry{});
+        mask = count ? count - 1 : 0;
+    }
+
+    void clear() {
+        std::fill(entries.begin(), entries.end(), EvalCacheEntry{});
+    }
+
+    bool probe(uint64_t key, int32_t &eval) {
+        if (entries.empty())
+            return false;
+
+        probes++;
+        const EvalCacheEntry &entry = entries[key & mask];
+        if (entry.key != key)
+            return false;
+
+        hits++;
+        eval = entry.eval;
+        return true;
+    }
+
+    void store(uint64_t key, int32_t eval) {
+        if (!entries.empty())
+            entries[key & mask] = EvalCacheEntry{ key, eval };
+    }
+};
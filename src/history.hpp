@@ -3,31 +3,25 @@
 #include <cstdint>
 #include "chess.hpp"
 #include "search.hpp"
+#include "search_thread.hpp"
+
+// All history tables live in the SearchThread, these are the helpers to
+// reset and use them
 
 // Killers
-extern chess::Move killers[2][MAX_SEARCH_PLY+1];
-void reset_killers();
+void reset_killers(SearchThread &thread);
 
 
 // Quiet History [color][from][to]
 constexpr int32_t MAX_HISTORY = 16384;
-extern int32_t quiet_history[2][64][64];
-void reset_quiet_history();
+void reset_quiet_history(SearchThread &thread);
 
 
 // Continuation history [previous piece][target sq][curr piece][target square]
-extern int32_t one_ply_conthist[12][64][12][64];
-extern int32_t two_ply_conthist[12][64][12][64];
-void reset_continuation_history();
+void reset_continuation_history(SearchThread &thread);
 
 // Correction history
-extern const int32_t corrhist_size;
-extern int32_t pawn_correction_history[2][16384];
-extern int32_t non_pawn_correction_history[2][16384];
-extern int32_t minor_correction_history[2][16384];
-extern int32_t major_correction_history[2][16384];
-
-void reset_correction_history();
-int32_t corrhist_adjust_eval(const chess::Board &board, int32_t raw_eval);
+void reset_correction_history(SearchThread &thread);
+int32_t corrhist_adjust_eval(const SearchThread &thread, const chess::Board &board, int32_t raw_eval);
 
-void update_correction_history(const chess::Board &board, int32_t depth, int32_t diff);
\ No newline at end of file
+void update_correction_history(SearchThread &thread, const chess::Board &board, int32_t depth, int32_t diff);
@@ -1,5 +1,8 @@
+#include <algorithm>
+
 #include "chess.hpp"
 #include "see.hpp"
+#include "moves.hpp"
 
 using namespace chess;
 
@@ -25,4 +28,119 @@ int32_t move_best_case_value(Board& board){
         
     return value;
 
-}
\ No newline at end of file
+}
+
+// Verifies moves we got from somewhere other than the move generator, so
+// we don't need to generate every move just to find out if the TT move
+// or a killer can be played here
+bool is_pseudo_legal(const Board& board, Move move){
+    if (move.move() == Move::NO_MOVE || move.move() == Move::NULL_MOVE)
+        return false;
+
+    Color us = board.sideToMove();
+    Square from = move.from();
+    Square to = move.to();
+    Piece piece = board.at(from);
+
+    if (piece == Piece::NONE || piece.color() != us)
+        return false;
+
+    // Castling and en passant are rare and have plenty of special
+    // conditions, so we just let the move generator decide for these
+    if (move.typeOf() == Move::CASTLING || move.typeOf() == Move::ENPASSANT){
+        Movelist moves{};
+        if (move.typeOf() == Move::CASTLING)
+            movegen::legalmoves<movegen::MoveGenType::QUIET>(moves, board, PieceGenType::KING);
+        else
+            movegen::legalmoves<movegen::MoveGenType::CAPTURE>(moves, board, PieceGenType::PAWN);
+
+        return std::find(moves.begin(), moves.end(), move) != moves.end();
+    }
+
+    // Can't capture our own pieces
+    if (board.us(us) & Bitboard::fromSquare(to))
+        return false;
+
+    // Non promotions must not have any promotion bits set, otherwise the
+    // move would not compare equal to the generated one
+    if (move.typeOf() == Move::NORMAL && move != Move::make<Move::NORMAL>(from, to))
+        return false;
+
+    Bitboard occ = board.occ();
+
+    if (piece.type() == PieceType::PAWN){
+        Rank promotion_rank = us == Color::WHITE ? Rank::RANK_8 : Rank::RANK_1;
+        if ((move.typeOf() == Move::PROMOTION) != (to.rank() == promotion_rank))
+            return false;
+
+        // Captures
+        if (board.at(to) != Piece::NONE)
+            return static_cast<bool>(attacks::pawn(us, from) & Bitboard::fromSquare(to));
+
+        // Single and double pushes
+        int32_t push = us == Color::WHITE ? 8 : -8;
+        if (to.index() == from.index() + push)
+            return true;
+
+        Rank start_rank = us == Color::WHITE ? Rank::RANK_2 : Rank::RANK_7;
+        return from.rank() == start_rank
+            && to.index() == from.index() + 2 * push
+            && board.at(Square(from.index() + push)) == Piece::NONE;
+    }
+
+    if (move.typeOf() != Move::NORMAL)
+        return false;
+
+    Bitboard targets{};
+    switch (static_cast<int>(piece.type())){
+        case static_cast<int>(PieceType::KNIGHT): targets = attacks::knight(from); break;
+        case static_cast<int>(PieceType::BISHOP): targets = attacks::bishop(from, occ); break;
+        case static_cast<int>(PieceType::ROOK):   targets = attacks::rook(from, occ); break;
+        case static_cast<int>(PieceType::QUEEN):  targets = attacks::queen(from, occ); break;
+        case static_cast<int>(PieceType::KING):   targets = attacks::king(from); break;
+        default: return false;
+    }
+
+    return static_cast<bool>(targets & Bitboard::fromSquare(to));
+}
+
+// Pretends to make the move on the occupancy and looks for enemy
+// attackers of our king. Expects a pseudo legal move
+bool is_legal(const Board& board, Move move, const AttackInfo* info){
+
+    // Already fully checked by the move generator in is_pseudo_legal
+    if (move.typeOf() == Move::CASTLING || move.typeOf() == Move::ENPASSANT)
+        return true;
+
+    // Out of check, only the king and pinned pieces can expose our king
+    if (info && !info->in_check() && !(info->pinned & (1ull << move.from().index()))
+        && board.at(move.from()).type() != PieceType::KING)
+        return true;
+
+    Color us = board.sideToMove();
+    Square from = move.from();
+    Square to = move.to();
+    Bitboard to_bb = Bitboard::fromSquare(to);
+
+    Bitboard occ = (board.occ() ^ Bitboard::fromSquare(from)) | to_bb;
+
+    // A captured piece doesn't attack anything anymore
+    Bitboard enemies = board.us(~us) & ~to_bb;
+
+    Square king_sq = board.at(from).type() == PieceType::KING ? to : board.kingSq(us);
+
+    Bitboard attackers = (attacks::knight(king_sq) & board.pieces(PieceType::KNIGHT))
+                       | (attacks::pawn(us, king_sq) & board.pieces(PieceType::PAWN))
+                       | (attacks::king(king_sq) & board.pieces(PieceType::KING))
+                       | (attacks::bishop(king_sq, occ) & board.pieces(PieceType::BISHOP, PieceType::QUEEN))
+                       | (attacks::rook(king_sq, occ) & board.pieces(PieceType::ROOK, PieceType::QUEEN));
+
+    return !static_cast<bool>(attackers & enemies);
+}
+
+// TT entries only store 16 bits of move, and a different position may
+// share our entry. Everything that plays the TT move goes through here
+Move tt_move_if_valid(const Board& board, uint16_t tt_move, const AttackInfo* info){
+    Move move(tt_move);
+    return is_pseudo_legal(board, move) && is_legal(board, move, info) ? move : Move{};
+}
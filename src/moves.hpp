@@ -1,4 +1,18 @@
 #pragma once
 #include "chess.hpp"
+#include "attack_info.hpp"
 
-int32_t move_best_case_value(chess::Board& board);
\ No newline at end of file
+int32_t move_best_case_value(chess::Board& board);
+
+// Checks whether a move that didn't come from the move generator (TT move,
+// killers) could be made by the side to move in this position. Only checks
+// piece placement and movement, not whether it leaves our king in check
+bool is_pseudo_legal(const chess::Board& board, chess::Move move);
+
+// Checks whether a pseudo legal move leaves our own king in check. With the
+// position's checkers and pins most moves need no attack lookups at all
+bool is_legal(const chess::Board& board, chess::Move move, const AttackInfo* info = nullptr);
+
+// Turns the 16 bit best move of a TT entry back into a move, or a null move
+// if it can't be played in this position (index collisions)
+chess::Move tt_move_if_valid(const chess::Board& board, uint16_t tt_move, const AttackInfo* info = nullptr);
@@ -0,0 +1,220 @@
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <cstdlib>
+#include <algorithm>
+#include <vector>
+
+#if defined(__AVX2__) || defined(__SSE4_1__)
+#include <immintrin.h>
+#endif
+
+#include "chess.hpp"
+#include "nnue.hpp"
+
+using namespace chess;
+using namespace std;
+
+bool use_nnue = false;
+
+// The network given to make with EVALFILE=<path> is linked into the binary
+#if defined(EVALFILE) && defined(__GNUC__) && !defined(_WIN32) && !defined(__APPLE__)
+asm(".section .rodata\n"
+    ".balign 64\n"
+    ".global weak_embedded_net\n"
+    "weak_embedded_net:\n"
+    ".incbin \"" EVALFILE "\"\n"
+    ".global weak_embedded_net_end\n"
+    "weak_embedded_net_end:\n"
+    ".previous\n");
+extern "C" const unsigned char weak_embedded_net[];
+extern "C" const unsigned char weak_embedded_net_end[];
+#define HAS_EMBEDDED_NET 1
+#endif
+
+namespace nnue {
+
+struct Network {
+    alignas(64) int16_t feature_weights[INPUT_SIZE][HIDDEN_SIZE];
+    alignas(64) int16_t feature_bias[HIDDEN_SIZE];
+    alignas(64) int16_t output_weights[2][HIDDEN_SIZE];
+    int16_t output_bias;
+};
+
+constexpr size_t NETWORK_VALUES = INPUT_SIZE * HIDDEN_SIZE + HIDDEN_SIZE + 2 * HIDDEN_SIZE + 1;
+
+static Network network;
+static bool loaded = false;
+
+// Trainers pad the file to a multiple of 64 bytes, accept both
+static bool load_from_memory(const unsigned char* data, size_t bytes) {
+    size_t expected = NETWORK_VALUES * sizeof(int16_t);
+    if (bytes != expected && bytes != (expected + 63) / 64 * 64)
+        return false;
+
+    const int16_t* values = reinterpret_cast<const int16_t*>(data);
+
+    // Larger output weights would give different evals in SIMD and scalar
+    // builds, check before we overwrite the current network
+    const int16_t* output_weights = values + INPUT_SIZE * HIDDEN_SIZE + HIDDEN_SIZE;
+    for (int32_t i = 0; i < 2 * HIDDEN_SIZE; i++) {
+        if (abs(output_weights[i]) > MAX_OUTPUT_WEIGHT)
+            return false;
+    }
+
+    auto read = [&values](int16_t* out, size_t count) {
+        memcpy(out, values, count * sizeof(int16_t));
+        values += count;
+    };
+    read(&network.feature_weights[0][0], INPUT_SIZE * HIDDEN_SIZE);
+    read(network.feature_bias, HIDDEN_SIZE);
+    read(&network.output_weights[0][0], 2 * HIDDEN_SIZE);
+    read(&network.output_bias, 1);
+
+    loaded = true;
+    return true;
+}
+
+bool load(const string& path) {
+    FILE* file = fopen(path.c_str(), "rb");
+    if (!file)
+        return false;
+
+    vector<unsigned char> data;
+    unsigned char buffer[1 << 16];
+    size_t count;
+    while ((count = fread(buffer, 1, sizeof(buffer), file)) > 0)
+        data.insert(data.end(), buffer, buffer + count);
+    fclose(file);
+
+    return load_from_memory(data.data(), data.size());
+}
+
+bool has_embedded() {
+#if defined(HAS_EMBEDDED_NET)
+    return true;
+#else
+    return false;
+#endif
+}
+
+bool load_embedded() {
+#if defined(HAS_EMBEDDED_NET)
+    return load_from_memory(weak_embedded_net, weak_embedded_net_end - weak_embedded_net);
+#else
+    return false;
+#endif
+}
+
+bool is_loaded() {
+    return loaded;
+}
+
+// Input index of a piece from white's [0] or black's [1] point of view.
+// Black sees the board flipped and its own pieces first
+static inline int32_t feature_index(int32_t perspective, Piece piece, int32_t sq) {
+    int32_t color = static_cast<int32_t>(piece.color());
+    int32_t type = static_cast<int32_t>(piece.type());
+    if (perspective == 1) {
+        color ^= 1;
+        sq ^= 56;
+    }
+    return color * 384 + type * 64 + sq;
+}
+
+// acc += or -= one row of feature weights
+template <bool ADD>
+static inline void update(int16_t* acc, const int16_t* weights) {
+#if defined(__AVX2__)
+    for (int32_t i = 0; i < HIDDEN_SIZE; i += 16) {
+        __m256i a = _mm256_load_si256(reinterpret_cast<const __m256i*>(acc + i));
+        __m256i w = _mm256_load_si256(reinterpret_cast<const __m256i*>(weights + i));
+        a = ADD ? _mm256_add_epi16(a, w) : _mm256_sub_epi16(a, w);
+        _mm256_store_si256(reinterpret_cast<__m256i*>(acc + i), a);
+    }
+#elif defined(__SSE4_1__)
+    for (int32_t i = 0; i < HIDDEN_SIZE; i += 8) {
+        __m128i a = _mm_load_si128(reinterpret_cast<const __m128i*>(acc + i));
+        __m128i w = _mm_load_si128(reinterpret_cast<const __m128i*>(weights + i));
+        a = ADD ? _mm_add_epi16(a, w) : _mm_sub_epi16(a, w);
+        _mm_store_si128(reinterpret_cast<__m128i*>(acc + i), a);
+    }
+#else
+    for (int32_t i = 0; i < HIDDEN_SIZE; i++)
+        acc[i] = ADD ? acc[i] + weights[i] : acc[i] - weights[i];
+#endif
+}
+
+void add_piece(Accumulator& acc, Piece piece, int32_t sq) {
+    update<true>(acc.values[0], network.feature_weights[feature_index(0, piece, sq)]);
+    update<true>(acc.values[1], network.feature_weights[feature_index(1, piece, sq)]);
+}
+
+void remove_piece(Accumulator& acc, Piece piece, int32_t sq) {
+    update<false>(acc.values[0], network.feature_weights[feature_index(0, piece, sq)]);
+    update<false>(acc.values[1], network.feature_weights[feature_index(1, piece, sq)]);
+}
+
+void refresh(Accumulator& acc, const Board& board) {
+    memcpy(acc.values[0], network.feature_bias, sizeof(network.feature_bias));
+    memcpy(acc.values[1], network.feature_bias, sizeof(network.feature_bias));
+
+    Bitboard occ = board.occ();
+    while (!occ.empty()) {
+        int32_t sq = occ.pop();
+        add_piece(acc, board.at(static_cast<Square>(sq)), sq);
+    }
+}
+
+// Sum of screlu(acc[i]) * weights[i], still scaled by QA * QA * QB.
+// clamp(x)^2 * w overflows int16, so we multiply clamp(x) * w first (fits
+// since load rejects |w| > MAX_OUTPUT_WEIGHT) and let madd do the second multiplication in int32
+static inline int32_t screlu_dot(const int16_t* acc, const int16_t* weights) {
+#if defined(__AVX2__)
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i qa = _mm256_set1_epi16(QA);
+    __m256i sum = _mm256_setzero_si256();
+    for (int32_t i = 0; i < HIDDEN_SIZE; i += 16) {
+        __m256i v = _mm256_load_si256(reinterpret_cast<const __m256i*>(acc + i));
+        __m256i w = _mm256_load_si256(reinterpret_cast<const __m256i*>(weights + i));
+        v = _mm256_min_epi16(_mm256_max_epi16(v, zero), qa);
+        sum = _mm256_add_epi32(sum, _mm256_madd_epi16(_mm256_mullo_epi16(v, w), v));
+    }
+    __m128i half = _mm_add_epi32(_mm256_castsi256_si128(sum), _mm256_extracti128_si256(sum, 1));
+    half = _mm_add_epi32(half, _mm_shuffle_epi32(half, 0x4E));
+    half = _mm_add_epi32(half, _mm_shuffle_epi32(half, 0xB1));
+    return _mm_cvtsi128_si32(half);
+#elif defined(__SSE4_1__)
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i qa = _mm_set1_epi16(QA);
+    __m128i sum = _mm_setzero_si128();
+    for (int32_t i = 0; i < HIDDEN_SIZE; i += 8) {
+        __m128i v = _mm_load_si128(reinterpret_cast<const __m128i*>(acc + i));
+        __m128i w = _mm_load_si128(reinterpret_cast<const __m128i*>(weights + i));
+        v = _mm_min_epi16(_mm_max_epi16(v, zero), qa);
+        sum = _mm_add_epi32(sum, _mm_madd_epi16(_mm_mullo_epi16(v, w), v));
+    }
+    sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, 0x4E));
+    sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, 0xB1));
+    return _mm_cvtsi128_si32(sum);
+#else
+    int32_t sum = 0;
+    for (int32_t i = 0; i < HIDDEN_SIZE; i++) {
+        int32_t v = std::clamp(static_cast<int32_t>(acc[i]), 0, QA);
+        sum += v * v * weights[i];
+    }
+    return sum;
+#endif
+}
+
+int32_t evaluate(const Accumulator& acc, Color stm) {
+    int32_t us = stm == Color::WHITE ? 0 : 1;
+    int32_t output = screlu_dot(acc.values[us], network.output_weights[0])
+                   + screlu_dot(acc.values[us ^ 1], network.output_weights[1]);
+
+    // Undo one QA of the squared activation, then the usual scaling
+    output = output / QA + network.output_bias;
+    return output * SCALE / (QA * QB);
+}
+
+}
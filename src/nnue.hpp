@@ -0,0 +1,55 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+#include "chess.hpp"
+
+// A simple 768 -> HIDDEN_SIZE x2 -> 1 perspective network with a squared
+// clipped ReLU, the same layout bullet's "simple" example trains. Weights
+// are raw little endian int16 in the order feature weights [768][HIDDEN_SIZE],
+// feature bias, output weights [2][HIDDEN_SIZE] (side to move first) and the
+// output bias
+namespace nnue {
+    constexpr int32_t INPUT_SIZE = 768;
+    constexpr int32_t HIDDEN_SIZE = 128;
+
+    // Quantisation of the feature transformer and output layer, and the
+    // scale from network output to centipawns
+    constexpr int32_t QA = 255;
+    constexpr int32_t QB = 64;
+    constexpr int32_t SCALE = 400;
+
+    // Largest output weight the SIMD evaluation handles exactly, it
+    // multiplies clamp(x) * w in int16 (see screlu_dot)
+    constexpr int32_t MAX_OUTPUT_WEIGHT = 32767 / QA;
+
+    // First layer outputs from white's and black's point of view. Updated
+    // piece by piece as moves are made, like EvalAccumulator
+    struct alignas(64) Accumulator {
+        int16_t values[2][HIDDEN_SIZE];
+    };
+
+    // Reads a network file, returns false (keeping the old network) if the
+    // file doesn't exist, has the wrong size or an output weight outside
+    // [-MAX_OUTPUT_WEIGHT, MAX_OUTPUT_WEIGHT]
+    bool load(const std::string& path);
+
+    // Loads the network embedded at compile time with EVALFILE, if any
+    bool load_embedded();
+    bool has_embedded();
+
+    bool is_loaded();
+
+    // Builds an accumulator from scratch
+    void refresh(Accumulator& acc, const chess::Board& board);
+
+    void add_piece(Accumulator& acc, chess::Piece piece, int32_t sq);
+    void remove_piece(Accumulator& acc, chess::Piece piece, int32_t sq);
+
+    // Score relative to stm in centipawns
+    int32_t evaluate(const Accumulator& acc, chess::Color stm);
+}
+
+// Whether search uses the network instead of the HCE, see the UseNNUE option
+extern bool use_nnue;
@@ -10,58 +10,133 @@
 #include "mvv_lva.hpp"
 #include "see.hpp"
 #include "search_info.hpp"
+#include "search_thread.hpp"
 #include "history.hpp"
+#include "moves.hpp"
 
 using namespace chess;
 
 constexpr int32_t TT_BONUS = 1000000;
-constexpr int32_t KILLER_BONUS = 90000;
-constexpr size_t MAX_MOVES = 256;
 
-// Main search sorting
-void sort_moves(Board& board, Movelist& movelist, bool tt_hit, uint16_t tt_move, int32_t ply, SearchInfo search_info) {
+MovePicker::MovePicker(SearchThread& thread, Move tt_move, int32_t ply, SearchInfo search_info)
+    : thread(thread), board(thread.board), search_info(search_info), tt_move(tt_move),
+      killer_1(thread.killers[0][ply]), killer_2(thread.killers[1][ply]) {}
 
+bool MovePicker::is_valid(Move move) const {
+    return is_pseudo_legal(board, move) && is_legal(board, move, &thread.checks_and_pins());
+}
+
+Move MovePicker::pick_best(Movelist& movelist, std::array<int32_t, MAX_MOVES>& scores, int32_t idx){
+    int32_t best_idx = idx;
+    for (int32_t i = idx + 1; i < movelist.size(); i++){
+        if (scores[i] > scores[best_idx])
+            best_idx = i;
+    }
+
+    std::swap(movelist[idx], movelist[best_idx]);
+    std::swap(scores[idx], scores[best_idx]);
+    return movelist[idx];
+}
+
+void MovePicker::score_captures(){
+    for (int32_t i = 0; i < captures.size(); i++)
+        capture_scores[i] = mvv_lva(board, captures[i]);
+}
+
+void MovePicker::score_quiets(){
     int32_t parent_move_piece = search_info.parent_move_piece;
     int32_t parent_move_square = search_info.parent_move_square;
     int32_t parent_parent_move_piece = search_info.parent_parent_move_piece;
     int32_t parent_parent_move_square = search_info.parent_parent_move_square;
+    bool turn = board.sideToMove() == Color::WHITE;
 
-    const size_t move_count = movelist.size();
-    assert(move_count <= MAX_MOVES);
+    for (int32_t i = 0; i < quiets.size(); i++){
+        const Move move = quiets[i];
+        int32_t piece = static_cast<int32_t>(board.at(move.from()).internal());
+        int32_t score = thread.quiet_history[turn][move.from().index()][move.to().index()];
 
-    std::array<std::pair<int32_t, Move>, MAX_MOVES> scored_moves;
+        if (parent_move_piece != -1 && parent_move_square != -1)
+            score += thread.one_ply_conthist[parent_move_piece][parent_move_square][piece][move.to().index()];
 
-    for (size_t i = 0; i < move_count; i++) {
-        const auto& move = movelist[i];
-        int32_t score = 0;
-
-        if (tt_hit && move.move() == tt_move) {
-            score = TT_BONUS;
-        } else if (board.isCapture(move)) {
-            score = mvv_lva(board, move);
-            score += see(board, move, 0) ? 0 : -10000000;
-        } else if (killers[0][ply] == move || killers[1][ply] == move) {
-            score = KILLER_BONUS;
-        } else {
-            score = quiet_history[board.sideToMove() == Color::WHITE][move.from().index()][move.to().index()];
-
-            if (parent_move_piece != -1 && parent_move_square != -1)
-                score += one_ply_conthist[parent_move_piece][parent_move_square][static_cast<int32_t>(board.at(move.from()).internal())][move.to().index()];
-
-            if (parent_parent_move_piece != -1 && parent_parent_move_square != -1)
-                score += two_ply_conthist[parent_parent_move_piece][parent_parent_move_square][static_cast<int32_t>(board.at(move.from()).internal())][move.to().index()];
-        }
-
-        scored_moves[i] = std::make_pair(score, move);
-    }
+        if (parent_parent_move_piece != -1 && parent_parent_move_square != -1)
+            score += thread.two_ply_conthist[parent_parent_move_piece][parent_parent_move_square][piece][move.to().index()];
 
-    std::stable_sort(scored_moves.begin(), scored_moves.begin() + move_count, [](const auto& a, const auto& b) {
-        return a.first > b.first;
-    });
+        quiet_scores[i] = score;
+    }
+}
 
-    for (size_t i = 0; i < move_count; i++) {
-        movelist[i] = scored_moves[i].second;
+Move MovePicker::next_move(){
+    switch (stage){
+        case PickerStage::TT_MOVE:
+            stage = PickerStage::GEN_CAPTURES;
+            if (tt_move != Move{})
+                return tt_move;
+            [[fallthrough]];
+
+        case PickerStage::GEN_CAPTURES:
+            movegen::legalmoves<movegen::MoveGenType::CAPTURE>(captures, board);
+            score_captures();
+            stage = PickerStage::GOOD_CAPTURES;
+            [[fallthrough]];
+
+        // Captures by MVV-LVA, SEE is only done once a capture is picked
+        case PickerStage::GOOD_CAPTURES:
+            while (capture_idx < captures.size()){
+                Move move = pick_best(captures, capture_scores, capture_idx++);
+                if (move == tt_move)
+                    continue;
+
+                if (see(board, move, 0))
+                    return move;
+
+                // Keep picked order for the bad captures
+                captures[bad_capture_count++] = move;
+            }
+            stage = PickerStage::KILLER_1;
+            [[fallthrough]];
+
+        // Killers are quiet moves, so in case they capture something in
+        // this position they were already picked in the capture stages
+        case PickerStage::KILLER_1:
+            stage = PickerStage::KILLER_2;
+            if (killer_1 != tt_move && !board.isCapture(killer_1) && is_valid(killer_1))
+                return killer_1;
+            killer_1 = Move{};
+            [[fallthrough]];
+
+        case PickerStage::KILLER_2:
+            stage = PickerStage::GEN_QUIETS;
+            if (killer_2 != tt_move && killer_2 != killer_1 && !board.isCapture(killer_2) && is_valid(killer_2))
+                return killer_2;
+            killer_2 = Move{};
+            [[fallthrough]];
+
+        case PickerStage::GEN_QUIETS:
+            movegen::legalmoves<movegen::MoveGenType::QUIET>(quiets, board);
+            score_quiets();
+            stage = PickerStage::QUIETS;
+            [[fallthrough]];
+
+        case PickerStage::QUIETS:
+            while (quiet_idx < quiets.size()){
+                Move move = pick_best(quiets, quiet_scores, quiet_idx++);
+                if (move != tt_move && move != killer_1 && move != killer_2)
+                    return move;
+            }
+            stage = PickerStage::BAD_CAPTURES;
+            [[fallthrough]];
+
+        case PickerStage::BAD_CAPTURES:
+            if (bad_capture_idx < bad_capture_count)
+                return captures[bad_capture_idx++];
+            stage = PickerStage::DONE;
+            [[fallthrough]];
+
+        case PickerStage::DONE:
+            break;
     }
+
+    return Move{};
 }
 
 // Captures sorting — returns a fixed-size std::array<bool, MAX_MOVES> and length
@@ -11,6 +11,64 @@
 #include "mvv_lva.hpp"
 #include "see.hpp"
 #include "search_info.hpp"
+#include "search_thread.hpp"
+
+constexpr size_t MAX_MOVES = 256;
+
+enum class PickerStage : uint8_t {
+    TT_MOVE,
+    GEN_CAPTURES,
+    GOOD_CAPTURES,
+    KILLER_1,
+    KILLER_2,
+    GEN_QUIETS,
+    QUIETS,
+    BAD_CAPTURES,
+    DONE
+};
+
+// Staged move picker for the main search. The TT move is tried before any
+// move is generated, then good captures, killers, quiets and finally bad
+// captures. Every stage is generated and scored only once we get to it, and
+// moves are picked one at a time, so a node that cuts off early never pays
+// for sorting the moves it didn't search
+class MovePicker {
+public:
+    // The TT move must already be checked with tt_move_if_valid
+    MovePicker(SearchThread& thread, chess::Move tt_move, int32_t ply, SearchInfo search_info);
+
+    // Returns the next legal move, or a null move when we are out of moves
+    chess::Move next_move();
+
+private:
+    SearchThread& thread;
+    chess::Board& board;
+    SearchInfo search_info;
+    PickerStage stage = PickerStage::TT_MOVE;
+
+    chess::Move tt_move{};
+    chess::Move killer_1{};
+    chess::Move killer_2{};
+
+    // Captures that fail SEE are moved to the front of the capture list
+    // as we go, so they can be searched last without another list
+    chess::Movelist captures{};
+    chess::Movelist quiets{};
+    std::array<int32_t, MAX_MOVES> capture_scores{};
+    std::array<int32_t, MAX_MOVES> quiet_scores{};
+    int32_t capture_idx = 0;
+    int32_t quiet_idx = 0;
+    int32_t bad_capture_count = 0;
+    int32_t bad_capture_idx = 0;
+
+    // Swaps the highest scored move left into movelist[idx] and returns it
+    chess::Move pick_best(chess::Movelist& movelist, std::array<int32_t, MAX_MOVES>& scores, int32_t idx);
+
+    // Checks a move that didn't come from our own move generation
+    bool is_valid(chess::Move move) const;
+
+    void score_captures();
+    void score_quiets();
+};
 
-void sort_moves(chess::Board& board, chess::Movelist& movelist, bool tt_hit, std::uint16_t tt_move, int32_t ply, SearchInfo search_info);
 std::array<bool, 256> sort_captures(chess::Board& board, chess::Movelist& movelist, bool tt_hit, std::uint16_t tt_move);
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cstdint>
+#include <algorithm>
+#include <vector>
+
+// Pawn structure terms only change when a pawn moves or is captured, which
+// is rare compared to how often we evaluate. Each search thread caches them
+// here, keyed by the pawn key the accumulator keeps (CorrectionKeys::pawn)
+struct PawnEntry {
+    uint64_t key = 0;
+
+    // Packed S(mg, eg) of doubled, passed, isolated and phalanx pawns, [0] white
+    int32_t scores[2]{};
+
+    // Pawn storm depends on which half of the board our king is on,
+    // so we keep it for both halves [side][king on files e-h]
+    int32_t storm[2][2]{};
+
+    // Passed pawns [side]
+    uint64_t passed[2]{};
+};
+
+// Power of 2 so the index is a mask, 48 bytes per entry
+constexpr size_t PAWN_HASH_ENTRIES = 16384;
+
+struct PawnHashTable {
+    std::vector<PawnEntry> entries = std::vector<PawnEntry>(PAWN_HASH_ENTRIES);
+
+    // Statistics for bench
+    int64_t probes = 0;
+    int64_t hits = 0;
+
+    PawnEntry &entry(uint64_t key) {
+        return entries[key & (PAWN_HASH_ENTRIES - 1)];
+    }
+
+    void clear() {
+        std::fill(entries.begin(), entries.end(), PawnEntry{});
+    }
+};
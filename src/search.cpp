@@ -4,6 +4,11 @@
 #include <algorithm>
 #include <cmath>
 #include <vector>
+#include <atomic>
+#include <thread>
+#include <memory>
+#include <functional>
+#include <mutex>
 
 #include "chess.hpp"
 #include "timeman.hpp"
@@ -13,57 +18,111 @@
 #include "ordering.hpp"
 #include "see.hpp"
 #include "defaults.hpp"
+#include "search_thread.hpp"
 #include "history.hpp"
 #include "moves.hpp"
 
 using namespace chess;
 using namespace std;
 
-// Summoning multithread demons with global vars!!
-// Storing the final best move for every complete search
-chess::Move root_best_move{};
-chess::Move previous_best_move{};
+// No more multithread demons, all search state lives in the SearchThread
+// and only the transposition table is shared between threads (Lazy SMP)
+std::vector<std::unique_ptr<SearchThread>> search_threads;
+
+// Set by the UCI thread on "stop" and by the main thread once it is done
+// so the helpers stop searching
+std::atomic<bool> stop_search{false};
+
+// The UCI thread and the search thread both write to stdout
+std::mutex output_mutex;
+
+// The search runs on its own thread so the UCI loop can still answer
+// "isready", "stop" and "quit" while we are thinking
+std::thread main_search_thread;
+
+// Creates or destroys search threads so we have exactly count of them
+void resize_search_threads(int32_t count){
+    search_threads.resize(count);
+    for (int32_t id = 0; id < count; id++){
+        if (!search_threads[id]){
+            search_threads[id] = std::make_unique<SearchThread>();
+            search_threads[id]->id = id;
+            search_threads[id]->eval_cache.resize(eval_cache_size.current);
+        }
+    }
+}
 
-int64_t best_move_nodes = 0;
+// Total nodes searched by all threads
+int64_t total_nodes_searched(){
+    int64_t nodes = 0;
+    for (auto &thread : search_threads)
+        nodes += thread->nodes();
+    return nodes;
+}
 
-// BM-stability
-int32_t bm_stability = 0;
+// Polled abort check, every node returns as soon as this is true and the search
+// unwinds without exceptions. The stop flag is only a relaxed load, reading the
+// clock is more expensive so the main thread only does it every few nodes. Depth
+// 1 is always completed so we have a move to play
+inline bool search_stopped(SearchThread &thread){
+    if (thread.stopped)
+        return true;
 
-// Score stability
-int32_t score_stability = 0;
-int32_t avg_prev_score = 0;
-int32_t root_best_score = 0;
+    if (thread.global_depth > 1 
+        && (stop_search.load(std::memory_order_relaxed) 
+            || (thread.id == 0 && thread.nodes() % TIME_CHECK_NODES == 0 && hard_bound_time_exceeded())))
+        thread.stopped = true;
 
-int64_t total_nodes_per_search = 0;
+    return thread.stopped;
+}
 
-int32_t global_depth = 0;
-int64_t total_nodes = 0;
+// Raw static eval of the current position. The TT stores the raw eval
+// next to the score, so a hit saves us the full evaluation. Otherwise the
+// thread's eval cache may still have it. Corrections are always applied
+// afterwards since the correction histories keep changing
+inline bool stored_static_eval(SearchThread &thread, bool tt_hit, const TTEntry &entry, int32_t &eval){
+    if (tt_hit && entry.static_eval != tt_packing::EVAL_NONE){
+        thread.saved_evals++;
+        eval = entry.static_eval;
+        return true;
+    }
+    return thread.eval_cache.probe(thread.board.hash(), eval);
+}
 
-// Highest searched depth
-int32_t seldpeth = 0;
+inline int32_t full_static_eval(SearchThread &thread){
+    int32_t eval = thread.evaluate();
+    thread.eval_cache.store(thread.board.hash(), eval);
+    return eval;
+}
 
-// Fail-high count for lmr [ply]
-// Since we reset failhaigh count of ply+1, and our max ply is 255,
-// we must have 256 + 1 = 257 elements
-int32_t fail_high_count[257]{};
+inline int32_t static_eval_of(SearchThread &thread, bool tt_hit, const TTEntry &entry){
+    int32_t eval;
+    if (stored_static_eval(thread, tt_hit, entry, eval))
+        return eval;
+    return full_static_eval(thread);
+}
 
 // Quiescence search. When we are in a noisy position (there are captures), we try to "quiet" the position by
 // going down capture trees using negamax and return the eval when we re in a quiet position
-int32_t q_search(Board &board, int32_t alpha, int32_t beta, int32_t ply){
+int32_t q_search(SearchThread &thread, int32_t alpha, int32_t beta, int32_t ply){
+
+    Board &board = thread.board;
+    bool in_check = thread.in_check();
 
     // Increment node count
-    total_nodes++;
-    total_nodes_per_search++;
+    thread.count_node();
+    thread.total_nodes_per_search++;
 
     // Handle time management
     // Here is also where our hard-bound time mnagement is. When the search time 
-    // exceeds our maximum hard bound time limit
-    if (global_depth > 1 && hard_bound_time_exceeded())
-        throw SearchAbort();
+    // exceeds our maximum hard bound time limit, the GUI sends "stop" or the
+    // main thread is done, we return straight away and unwind the search
+    if (search_stopped(thread))
+        return 0;
 
     // Update highest searched depth
-    if (ply > seldpeth)
-        seldpeth = ply;
+    if (ply > thread.seldpeth)
+        thread.seldpeth = ply;
 
     // Draw detections
     if ((board.isHalfMoveDraw() || board.isInsufficientMaterial() || board.isRepetition(1)))
@@ -84,10 +143,28 @@ int32_t q_search(Board &board, int32_t alpha, int32_t beta, int32_t ply){
     // Eval pruning - If a static evaluation of the board will
     // exceed beta, then we can stop the search here. Also, if the static
     // eval exceeds alpha, we can set alpha to our new eval (comment from Ethereal)
-    int32_t eval = evaluate(board);
+    int32_t raw_eval;
+    if (!stored_static_eval(thread, tt_hit, entry, raw_eval)){
+
+        // Lazy evaluation - When material and piece square tables alone are
+        // so far above beta, or below alpha even after the best capture, that
+        // the remaining HCE terms can't bring the eval back into the window,
+        // stand pat on the estimate and skip the full evaluation. Never in
+        // check, where the evasions have to be searched
+        if (!use_nnue && !in_check){
+            int32_t lazy_eval = corrhist_adjust_eval(thread, board, lazy_evaluate(board, thread.accumulator()));
+            thread.lazy_eval_probes++;
+            if (lazy_eval - lazy_eval_margin.current >= beta
+                || lazy_eval + lazy_eval_margin.current + max(delta_pruning_pawn_bonus.current, move_best_case_value(board)) < alpha){
+                thread.lazy_eval_cutoffs++;
+                return lazy_eval;
+            }
+        }
+        raw_eval = full_static_eval(thread);
+    }
 
     // Correct static evaluation with our correction histories
-    eval = corrhist_adjust_eval(board, eval);
+    int32_t eval = corrhist_adjust_eval(thread, board, raw_eval);
 
     int32_t best_score = eval;
     if (best_score >= beta) return best_score;
@@ -125,7 +202,7 @@ int32_t q_search(Board &board, int32_t alpha, int32_t beta, int32_t ply){
 
         // QSearch movecount pruning
         // STC: 25.78 +- 14.91
-        if (!board.inCheck() && moves_played >= 2)
+        if (!in_check && moves_played >= 2)
             break;
 
         Move current_move = capture_moves[idx];
@@ -137,10 +214,14 @@ int32_t q_search(Board &board, int32_t alpha, int32_t beta, int32_t ply){
 
         // Basic make and undo functionality. Copy-make should be faster but that
         // debugging is for later
-        board.makeMove(current_move);
+        thread.make_move(current_move);
+        tt.prefetch(board.hash());
         moves_played++;
-        int32_t score = -q_search(board, -beta, -alpha, ply + 1);
-        board.unmakeMove(current_move);
+        int32_t score = -q_search(thread, -beta, -alpha, ply + 1);
+        thread.unmake_move(current_move);
+
+        if (thread.stopped)
+            return 0;
 
         // Updating best_score and alpha beta pruning
         if (score > best_score){
@@ -162,7 +243,7 @@ int32_t q_search(Board &board, int32_t alpha, int32_t beta, int32_t ply){
     uint16_t best_move_tt = bound == NodeType::UPPERBOUND ? entry.best_move : current_best_move.move();
 
     // Storing transpositions
-    tt.store(zobrists_key, best_score, 0, bound, best_move_tt, tt_hit ? entry.tt_was_pv : false);
+    tt.store(zobrists_key, best_score, raw_eval, 0, bound, best_move_tt, tt_hit ? entry.tt_was_pv : false);
 
     return best_score;
 }
@@ -173,13 +254,15 @@ int32_t q_search(Board &board, int32_t alpha, int32_t beta, int32_t ply){
 // ply. This works because a position which is a win for white is a loss for black and vice versa. Most "strong" chess engines use
 // negamax instead of minimax because it makes the code much tidier. Not sure about how much is gains though. The "fail soft" basically
 // means we return max_value instead of alpha. This gives us more information to do puning etc etc.
-int32_t alpha_beta(Board &board, int32_t depth, int32_t alpha, int32_t beta, int32_t ply, bool cut_node, SearchInfo search_info){
+int32_t alpha_beta(SearchThread &thread, int32_t depth, int32_t alpha, int32_t beta, int32_t ply, bool cut_node, SearchInfo search_info){
+
+    Board &board = thread.board;
 
     // Search variables
     // max_score for fail-soft negamax
     int32_t best_score = -POSITIVE_INFINITY;
     bool is_root = ply == 0;
-    bool in_check = board.inCheck();
+    bool in_check = thread.in_check();
 
     // Important for cutoffs
     // I'm aware this is not the best way to do it but that's for later
@@ -194,18 +277,19 @@ int32_t alpha_beta(Board &board, int32_t depth, int32_t alpha, int32_t beta, int
     int32_t old_alpha = alpha;  
 
     // Increment node count
-    total_nodes++;
-    total_nodes_per_search++;
+    thread.count_node();
+    thread.total_nodes_per_search++;
 
     // Handle time management
     // Here is where our hard-bound time mnagement is. When the search time 
-    // exceeds our maximum hard bound time limit
-    if (global_depth > 1 && hard_bound_time_exceeded())
-        throw SearchAbort();
+    // exceeds our maximum hard bound time limit, the GUI sends "stop" or the
+    // main thread is done, we return straight away and unwind the search
+    if (search_stopped(thread))
+        return 0;
 
      // Update highest searched depth
-    if (ply > seldpeth)
-        seldpeth = ply;
+    if (ply > thread.seldpeth)
+        thread.seldpeth = ply;
 
     // Draw detections
     // Ensure all drawn positions have a score of 0. This is important so
@@ -219,38 +303,35 @@ int32_t alpha_beta(Board &board, int32_t depth, int32_t alpha, int32_t beta, int
     if (!is_root && (board.isHalfMoveDraw() || board.isInsufficientMaterial() || board.isRepetition(1)))
         return 0;
 
-    // Get all legal moves for our moveloop in our search
-    Movelist all_moves{};
-    movegen::legalmoves(all_moves, board);
-
-    // Checkmate detection
-    // When we are in checkmate during our turn, we lost the game, therefore we 
-    // should return a large negative value
-    if (!is_root && all_moves.size() == 0){
-        if (in_check)
-            return -POSITIVE_MATE_SCORE + ply;
-
-        // Stalemate jumpscare!
-        else 
-            return 0;
-    }
-
     // Max ply cutoff to avoid ubs with our arrays
     if (ply >= MAX_SEARCH_PLY){
-        return evaluate(board);
+        return thread.evaluate();
     }
 
     // Depth <= 0 (because we allow depth to drop below 0) and 
     // perform a qsearch to stabilise evaluation and avoid
     // the horizon effect
     if (depth <= 0){
-        return q_search(board, alpha, beta, ply);
+
+        // Mate and stalemate detection at the horizon, the move loop finds
+        // them everywhere else. qsearch only looks at captures, so it can't
+        // tell a checkmate from a quiet check or a stalemate from a quiet
+        // position
+        Movelist legal_moves{};
+        movegen::legalmoves(legal_moves, board);
+        if (legal_moves.size() == 0)
+            return in_check ? -POSITIVE_MATE_SCORE + ply : 0;
+
+        return q_search(thread, alpha, beta, ply);
     }
 
     // Reset fail-high count for next ply
-    fail_high_count[ply + 1] = 0;
+    thread.fail_high_count[ply + 1] = 0;
 
     // Get the TT Entry for current position
+    // Nothing is generated before this, so TT cutoffs, reverse futility pruning,
+    // razoring and null move pruning never pay for a move list. Mates and
+    // stalemates are found once the move loop runs out of moves
     TTEntry entry{};
     uint64_t zobrists_key = board.hash(); 
     bool tt_hit = tt.probe(zobrists_key, entry);
@@ -266,14 +347,14 @@ int32_t alpha_beta(Board &board, int32_t depth, int32_t alpha, int32_t beta, int
         return entry.score;
 
     // Static evaluation for pruning metrics
-    int32_t raw_eval = evaluate(board);
+    int32_t raw_eval = static_eval_of(thread, tt_hit, entry);
 
     // Correct static evaluation with our correction histories
     // STC: 20.87 +- 9.48 (pawn)
     // STC: 3.49 +- 2.77 (non pawn)
     // STC: 9.93 +- 6.18 (minor)
     // STC: 15.42 +- 7.84 (major)
-    int32_t static_eval = corrhist_adjust_eval(board, raw_eval);
+    int32_t static_eval = corrhist_adjust_eval(thread, board, raw_eval);
 
     // Improving heuristic (Whether we are at a better position than 2 plies before)
     // bool improving = static_eval > search_info.parent_parent_eval && search_info.parent_parent_eval != -100000;
@@ -303,7 +384,7 @@ int32_t alpha_beta(Board &board, int32_t depth, int32_t alpha, int32_t beta, int
         && depth <= 3 
         && static_eval + razoring_base.current + razoring_quad_mul.current * depth * depth <= alpha  
         && search_info.excluded == 0){
-        return q_search(board, alpha, beta, ply + 1);
+        return q_search(thread, alpha, beta, ply + 1);
     }
 
     // Null move pruning. Basically, we can assume that making a move 
@@ -320,21 +401,29 @@ int32_t alpha_beta(Board &board, int32_t depth, int32_t alpha, int32_t beta, int
         && (!tt_hit || !(entry.type == NodeType::UPPERBOUND) || entry.score >= beta) && (board.hasNonPawnMaterial(Color::WHITE) || board.hasNonPawnMaterial(Color::BLACK)) 
         && search_info.excluded == 0){
         
-        board.makeNullMove();
+        thread.make_null_move();
+        tt.prefetch(board.hash());
         int32_t reduction = null_move_base.current + depth / null_move_divisor.current;
                                                                                         
         // Search has no parents :(
         SearchInfo info{};                                                                   
         info.parent_parent_move_piece = parent_move_piece;
         info.parent_parent_move_square = parent_move_square;                                // Child of a cut node is a all-node and vice versa
-        int32_t null_score = -alpha_beta(board, depth - reduction, -beta, -beta+1, ply + 1, !cut_node, info);
-        board.unmakeNullMove();
+        int32_t null_score = -alpha_beta(thread, depth - reduction, -beta, -beta+1, ply + 1, !cut_node, info);
+        thread.unmake_null_move();
+
+        if (thread.stopped)
+            return 0;
 
         if (null_score >= beta)
             // Do not return false mates in null move pruning (patch)
             return abs(null_score) >= POSITIVE_WIN_SCORE ? beta : null_score;
     }
 
+    // Only validated once nothing above has cut off, IIR and the move
+    // picker are the first to need it
+    Move tt_move = tt_hit ? tt_move_if_valid(board, entry.best_move, &thread.checks_and_pins()) : Move{};
+
     // Internal iterative reduction. Artifically lower the depth on pv nodes / cutnodes
     // that are high enough up in the search tree that we would expect to find a transposition
     // to use later. (Comment from Ethereal)
@@ -344,7 +433,7 @@ int32_t alpha_beta(Board &board, int32_t depth, int32_t alpha, int32_t beta, int
     if ((pv_node || cut_node) 
         && !in_check 
         && depth >= 7 
-        && (!tt_hit || (entry.best_move != 0 && entry.depth <= depth - 5)) 
+        && (!tt_hit || (tt_move != Move{} && entry.depth <= depth - 5)) 
         && search_info.excluded == 0)
         depth--;
 
@@ -357,27 +446,27 @@ int32_t alpha_beta(Board &board, int32_t depth, int32_t alpha, int32_t beta, int
     Move quiets_searched[1024]{};
     int32_t quiets_searched_idx = 0;
 
-    // Clear killers of next ply
-    killers[0][ply+1] = Move{}; 
-    killers[1][ply+1] = Move{}; 
+    // Clear thread.killers of next ply
+    thread.killers[0][ply+1] = Move{}; 
+    thread.killers[1][ply+1] = Move{}; 
 
     // Move orderings
     // 1st TT Move (STC: 354.04 +/- 42.86)
     // 2nd MVV-LVA (STC: 109.50 +/- 25.18 (Note this is when mvv-lva was buggy)) + SEE (STC: 24.53 +- 14.42)
-    // 3rd Killers Moves (quiets) (STC: 29.88 +/- 10.55) and (STC: 10.77 +/- 6.38) for two killers
+    // 3rd Killers Moves (quiets) (STC: 29.88 +/- 10.55) and (STC: 10.77 +/- 6.38) for two thread.killers
     // 4th Histories (quiets) (STC: 41.16 +/- 13.63)
     //      - 1 ply conthist (countermoves) (STC: 31.45 +- 16.47)
     //      - 2 ply conthist (follow-up moves) (STC: 6.57 +- 5.04)
-    sort_moves(board, all_moves, tt_hit, entry.best_move, ply, search_info);
+    // 5th Captures that fail SEE
+    MovePicker picker(thread, tt_move, ply, search_info);
+    Move current_move{};
 
-    for (int idx = 0; idx < all_moves.size(); idx++){
+    while ((current_move = picker.next_move()) != Move{}){
 
         int32_t new_depth = depth;
         int32_t reduction = 0;
         int32_t extension = 0;
-        int64_t nodes_b4 = total_nodes;
-
-        Move current_move = all_moves[idx];
+        int64_t nodes_b4 = thread.nodes();
 
         // Skip excluded singular moves
         if (current_move.move() == search_info.excluded)
@@ -385,7 +474,7 @@ int32_t alpha_beta(Board &board, int32_t depth, int32_t alpha, int32_t beta, int
 
         move_count++;
         bool is_noisy_move = board.isCapture(current_move);
-        int32_t move_history = !is_noisy_move ? quiet_history[board.sideToMove() == chess::Color::WHITE][current_move.from().index()][current_move.to().index()] : 0;
+        int32_t move_history = !is_noisy_move ? thread.quiet_history[board.sideToMove() == chess::Color::WHITE][current_move.from().index()][current_move.to().index()] : 0;
 
         // Quiet Move Prunings
         if (!is_root && !is_noisy_move && best_score > -POSITIVE_WIN_SCORE) {
@@ -417,7 +506,7 @@ int32_t alpha_beta(Board &board, int32_t depth, int32_t alpha, int32_t beta, int
         // STC: 5.73 +- 4.23 (negative-extensions)
         // STC: 8.62 +- 5.57 (double extent) 
         bool do_singular_search =  !is_root &&  depth >= 6 
-                                    &&  current_move.move() == entry.best_move 
+                                    &&  current_move == tt_move 
                                     &&  entry.depth >= depth - 3 
                                     && (entry.type == NodeType::LOWERBOUND) 
                                     && search_info.excluded == 0;
@@ -429,8 +518,11 @@ int32_t alpha_beta(Board &board, int32_t depth, int32_t alpha, int32_t beta, int
             int32_t singular_beta = value;
             int32_t singular_depth = (depth - 1) / 2;
 
-            se_info.excluded = entry.best_move;
-            int32_t score = alpha_beta(board, singular_depth, singular_beta - 1, singular_beta, ply, cut_node, se_info); 
+            se_info.excluded = tt_move.move();
+            int32_t score = alpha_beta(thread, singular_depth, singular_beta - 1, singular_beta, ply, cut_node, se_info); 
+
+            if (thread.stopped)
+                return 0;
 
             if (score < singular_beta){
                 extension = 1;
@@ -498,7 +590,7 @@ int32_t alpha_beta(Board &board, int32_t depth, int32_t alpha, int32_t beta, int
             // Fail-High LMR
             // Reduce more if this branch is known to fail high
             // STC: 5.41 +- 4.10
-            reduction += !is_root && fail_high_count[ply + 1] > 2;
+            reduction += !is_root && thread.fail_high_count[ply + 1] > 2;
 
             // Reduce less in ttpv nodes
             // STC: 5.18 +- 3.94
@@ -510,7 +602,7 @@ int32_t alpha_beta(Board &board, int32_t depth, int32_t alpha, int32_t beta, int
 
             // Reduce less for killer moves
             // STC: 5.45 +- 4.10
-            reduction -= (killers[0][ply] == current_move) || (killers[1][ply] == current_move);
+            reduction -= (thread.killers[0][ply] == current_move) || (thread.killers[1][ply] == current_move);
         }
 
         // Capture late move reductions - since the move is a capture
@@ -532,13 +624,18 @@ int32_t alpha_beta(Board &board, int32_t depth, int32_t alpha, int32_t beta, int
 
         // Basic make and undo functionality. Copy-make should be faster but that
         // debugging is for later
-        board.makeMove(current_move);
+        thread.make_move(current_move);
+
+        // The child probes the TT only after its own prologue, start loading
+        // its cluster now. The library keeps its zobrist keys private, so we
+        // can't compute the child key any earlier than this
+        tt.prefetch(board.hash());
 
         // Check extension, we increase the depth of moves that give check
         // This helps mitigate the horizon effect where noisy nodes are 
         // mistakenly evaluated
         // STC: 19.66 +/- 8.51,
-        if (extension == 0 && board.inCheck())
+        if (extension == 0 && thread.in_check())
             extension++;
 
         if (!is_noisy_move) 
@@ -558,11 +655,11 @@ int32_t alpha_beta(Board &board, int32_t depth, int32_t alpha, int32_t beta, int
         // STC: 54.25 +/- 15.03
         // STC: 27.39 +/- 11.81 (Triple PVS)
         if (move_count == 1)
-            score = -alpha_beta(board, new_depth, -beta, -alpha, ply + 1, false, info);
+            score = -alpha_beta(thread, new_depth, -beta, -alpha, ply + 1, false, info);
         else {
             // LMR Moves
             if (reduction > 0){
-                score = -alpha_beta(board, new_depth - reduction, -alpha - 1, -alpha, ply + 1, true, info);
+                score = -alpha_beta(thread, new_depth - reduction, -alpha - 1, -alpha, ply + 1, true, info);
 
                 // Triple PVS research if reduced score beats alpha
                 // We have dynamic conditions to change the depth of 
@@ -575,20 +672,25 @@ int32_t alpha_beta(Board &board, int32_t depth, int32_t alpha, int32_t beta, int
 
                 if (score > alpha){ 
                     new_depth += do_deeper - do_shallower;                                        
-                    score = -alpha_beta(board, new_depth, -alpha - 1, -alpha, ply + 1, !cut_node, info);
+                    score = -alpha_beta(thread, new_depth, -alpha - 1, -alpha, ply + 1, !cut_node, info);
                 }
             }
             else {
-                score = -alpha_beta(board, new_depth, -alpha - 1, -alpha, ply + 1, !cut_node, info);
+                score = -alpha_beta(thread, new_depth, -alpha - 1, -alpha, ply + 1, !cut_node, info);
             }
 
             // Research
             if (score > alpha && score < beta) {
-                score = -alpha_beta(board, new_depth, -beta, -alpha, ply + 1, false, info);
+                score = -alpha_beta(thread, new_depth, -beta, -alpha, ply + 1, false, info);
             }
         }
 
-        board.unmakeMove(current_move);
+        thread.unmake_move(current_move);
+
+        // Don't trust anything from an aborted search, especially
+        // not at the root
+        if (thread.stopped)
+            return 0;
 
         // Updating best_score and alpha beta pruning
         if (score > best_score){
@@ -596,11 +698,11 @@ int32_t alpha_beta(Board &board, int32_t depth, int32_t alpha, int32_t beta, int
             current_best_move = current_move;
 
             if (is_root){
-                root_best_move = current_move;
+                thread.root_best_move = current_move;
 
                 // Node time management, we get total number of nodes spent searching on best move
                 // and scale our tm based on it
-                best_move_nodes = total_nodes - nodes_b4;
+                thread.best_move_nodes = thread.nodes() - nodes_b4;
             }
 
             // Update alpha
@@ -611,31 +713,31 @@ int32_t alpha_beta(Board &board, int32_t depth, int32_t alpha, int32_t beta, int
                 if (alpha >= beta){
 
                     // Update fail-high count
-                    fail_high_count[ply]++;
+                    thread.fail_high_count[ply]++;
 
                     // Quiet move heuristics
                     if (!is_noisy_move){
                         // Killer move heuristic
-                        // We have 2 killers per ply
-                        // We don't duplicate killers
-                        if (current_move != killers[0][ply]){
-                            killers[1][ply] = killers[0][ply]; 
-                            killers[0][ply] = current_move;
+                        // We have 2 thread.killers per ply
+                        // We don't duplicate thread.killers
+                        if (current_move != thread.killers[0][ply]){
+                            thread.killers[1][ply] = thread.killers[0][ply]; 
+                            thread.killers[0][ply] = current_move;
                         }
 
                         // History Heuristic + gravity
                         int32_t bonus = min(history_bonus_mul_quad.current * depth * depth + history_bonus_mul_linear.current * depth + history_bonus_base.current, 2048);
-                        quiet_history[turn][from][to] += bonus - quiet_history[turn][from][to] * abs(bonus) / MAX_HISTORY;
+                        thread.quiet_history[turn][from][to] += bonus - thread.quiet_history[turn][from][to] * abs(bonus) / MAX_HISTORY;
 
                         // Continuation History Update
                         // 1-ply (Countermoves)
                         if (parent_move_piece != -1 && parent_move_square != -1){
-                            one_ply_conthist[parent_move_piece][parent_move_square][move_piece][to] += bonus - one_ply_conthist[parent_move_piece][parent_move_square][move_piece][to] * abs(bonus) / MAX_HISTORY;
+                            thread.one_ply_conthist[parent_move_piece][parent_move_square][move_piece][to] += bonus - thread.one_ply_conthist[parent_move_piece][parent_move_square][move_piece][to] * abs(bonus) / MAX_HISTORY;
                         }
                         
                         // 2-ply (Follow-up moves)
                         if (parent_parent_move_piece != -1 && parent_parent_move_square != -1){
-                            two_ply_conthist[parent_parent_move_piece][parent_parent_move_square][move_piece][to] += bonus - two_ply_conthist[parent_parent_move_piece][parent_parent_move_square][move_piece][to] * abs(bonus) / MAX_HISTORY;
+                            thread.two_ply_conthist[parent_parent_move_piece][parent_parent_move_square][move_piece][to] += bonus - thread.two_ply_conthist[parent_parent_move_piece][parent_parent_move_square][move_piece][to] * abs(bonus) / MAX_HISTORY;
                         }
 
                         // All History Malus
@@ -649,18 +751,18 @@ int32_t alpha_beta(Board &board, int32_t depth, int32_t alpha, int32_t beta, int
                             // Quiet History Malus
                             // STC: 35.24 +/- 13.39
                             if (!board.isCapture(current_best_move)){
-                                quiet_history[turn][from][to] = clamp(quiet_history[turn][from][to] - malus, -MAX_HISTORY, MAX_HISTORY);
+                                thread.quiet_history[turn][from][to] = clamp(thread.quiet_history[turn][from][to] - malus, -MAX_HISTORY, MAX_HISTORY);
                             }
 
                             // Conthist Malus
                             // 1-ply (Countermoves)
                             if (parent_move_piece != -1 && parent_move_square != -1){
-                                one_ply_conthist[parent_move_piece][parent_move_square][move_piece][to] = clamp(one_ply_conthist[parent_move_piece][parent_move_square][move_piece][to] - malus, -MAX_HISTORY, MAX_HISTORY);
+                                thread.one_ply_conthist[parent_move_piece][parent_move_square][move_piece][to] = clamp(thread.one_ply_conthist[parent_move_piece][parent_move_square][move_piece][to] - malus, -MAX_HISTORY, MAX_HISTORY);
                             }
 
                             // 2-ply (Follow-up moves)
                             if (parent_parent_move_piece != -1 && parent_parent_move_square != -1){
-                                two_ply_conthist[parent_parent_move_piece][parent_parent_move_square][move_piece][to]  = clamp(two_ply_conthist[parent_parent_move_piece][parent_parent_move_square][move_piece][to] - malus, -MAX_HISTORY, MAX_HISTORY);
+                                thread.two_ply_conthist[parent_parent_move_piece][parent_parent_move_square][move_piece][to]  = clamp(thread.two_ply_conthist[parent_parent_move_piece][parent_parent_move_square][move_piece][to] - malus, -MAX_HISTORY, MAX_HISTORY);
                             }
                         }
                     }
@@ -674,6 +776,13 @@ int32_t alpha_beta(Board &board, int32_t depth, int32_t alpha, int32_t beta, int
     if (move_count == 0 && search_info.excluded != 0)
         return alpha;
 
+    // Checkmate detection
+    // Moves are generated lazily, so we only know that we have no legal
+    // moves once the picker runs out. When we are in checkmate during our
+    // turn, we lost the game, therefore we should return a large negative value
+    if (move_count == 0)
+        return in_check ? -POSITIVE_MATE_SCORE + ply : 0;
+
     // Don't store TT in singular searches
     if (search_info.excluded == 0){
         NodeType bound = best_score >= beta ? NodeType::LOWERBOUND : alpha > old_alpha ? NodeType::EXACT : NodeType::UPPERBOUND;
@@ -685,11 +794,11 @@ int32_t alpha_beta(Board &board, int32_t depth, int32_t alpha, int32_t beta, int
             && !(bound == NodeType::UPPERBOUND && best_score >= static_eval)) {
             
             int32_t corrhist_bonus = clamp(best_score - static_eval, -1024, 1024);
-            update_correction_history(board, depth, corrhist_bonus);
+            update_correction_history(thread, board, depth, corrhist_bonus);
         }
 
         // Storing transpositions
-        tt.store(zobrists_key, best_score, depth, bound, best_move_tt, tt_was_pv);
+        tt.store(zobrists_key, best_score, raw_eval, depth, bound, best_move_tt, tt_was_pv);
     }
 
     return best_score;
@@ -702,21 +811,13 @@ void print_tt_pv(Board &board, int32_t depth){
     if (depth > 0){
         TTEntry entry{};
         uint64_t zobrists_key = board.hash(); 
-        tt.probe(zobrists_key, entry);
-        Movelist all_moves{};
-        movegen::legalmoves(all_moves, board);
-
-        bool is_legal = false;
-        for (int32_t i = 0; i < all_moves.size(); i++){
-            if (all_moves[i].move() == entry.best_move){
-                cout << " " << uci::moveToUci(all_moves[i]);
-                board.makeMove(all_moves[i]);
-                is_legal = true;
-                break;
-            }
-        }
+        if (!tt.probe(zobrists_key, entry))
+            return;
 
-        if (is_legal){
+        Move tt_move = tt_move_if_valid(board, entry.best_move);
+        if (tt_move != Move{}){
+            cout << " " << uci::moveToUci(tt_move);
+            board.makeMove(tt_move);
             print_tt_pv(board, depth - 1);
         }
     }
@@ -724,99 +825,195 @@ void print_tt_pv(Board &board, int32_t depth){
 }
 
 
-// Iterative deepening time management loop
-// Uses soft bound time management
-int32_t search_root(Board &board){
-    try {
-        // Aspiration window search, we predict that the score from previous searches will be
-        // around the same as the next depth +/- some margin.
-        // STC: 40.83 +/- 13.86
-        // STC: 7.34 +/- 5.30 (bugfix 1)
-        // STC:  12.94 +- 7.19 (bugfix 2)
-        int32_t score = 0;
-        int32_t delta = aspiration_window_delta.current;
-        int32_t alpha = DEFAULT_ALPHA;
-        int32_t beta = DEFAULT_BETA;
-        while ((global_depth == 0 || !soft_bound_time_exceeded()) && global_depth < MAX_SEARCH_DEPTH){
+// Gets the move we expect the opponent to reply with after our best move,
+// the second move of the transposition PV. Returns a null move if the TT
+// doesn't know a legal reply
+Move get_ponder_move(Board board, Move best_move){
+    if (best_move == Move{})
+        return Move{};
 
-            previous_best_move = root_best_move;
+    board.makeMove(best_move);
 
-            // Increment the global depth since global_depth starts from 0
-            global_depth++;
-            int32_t researches = 0;
-            int32_t new_score = 0;
+    TTEntry entry{};
+    if (!tt.probe(board.hash(), entry))
+        return Move{};
 
-            if (global_depth >= 4){
-                alpha = max(-POSITIVE_INFINITY, score - delta);
-                beta = min(POSITIVE_INFINITY, score + delta);
-            }
+    return tt_move_if_valid(board, entry.best_move);
+}
 
-            while (true){
+// Iterative deepening time management loop
+// Uses soft bound time management. This is shared by the main thread and the
+// Lazy SMP helpers. Only the main thread prints info and checks the soft bound,
+// the helpers keep searching deeper until the main thread tells them to stop
+void iterative_deepening(SearchThread &thread){
+
+    Board &board = thread.board;
+
+    // Aspiration window search, we predict that the score from previous searches will be
+    // around the same as the next depth +/- some margin.
+    // STC: 40.83 +/- 13.86
+    // STC: 7.34 +/- 5.30 (bugfix 1)
+    // STC:  12.94 +- 7.19 (bugfix 2)
+    int32_t score = 0;
+    int32_t delta = aspiration_window_delta.current;
+    int32_t alpha = DEFAULT_ALPHA;
+    int32_t beta = DEFAULT_BETA;
+    while ((thread.global_depth == 0 || thread.id != 0 || !soft_bound_time_exceeded(thread)) && thread.global_depth < MAX_SEARCH_DEPTH){
+
+        thread.previous_best_move = thread.root_best_move;
+
+        // Increment the global depth since global_depth starts from 0
+        thread.global_depth++;
+        int32_t researches = 0;
+        int32_t new_score = 0;
+
+        // Lazy SMP depth offsets, odd helpers search one ply deeper than
+        // the rest so the threads don't all search the exact same tree
+        int32_t depth = min(thread.global_depth + (thread.id & 1), MAX_SEARCH_DEPTH);
+
+        if (thread.global_depth >= 4){
+            alpha = max(-POSITIVE_INFINITY, score - delta);
+            beta = min(POSITIVE_INFINITY, score + delta);
+        }
 
-                total_nodes_per_search = 0ll;
-                SearchInfo info{};
-                new_score = alpha_beta(board, global_depth, alpha, beta, 0, false, info);
-                int64_t elapsed_time = elapsed_ms();
+        while (true){
 
-                // Upperbound
-                if (new_score <= alpha){
-                    cout << "info depth " << global_depth << " seldepth " << seldpeth << " time " << elapsed_time << " score cp " << alpha << " upperbound nodes " << total_nodes << " nps " <<   (1000 * total_nodes) / (elapsed_time + 1) << " hashfull " << tt.hashfull() << " pv " << uci::moveToUci(root_best_move);
+            thread.total_nodes_per_search = 0ll;
+            SearchInfo info{};
+            new_score = alpha_beta(thread, depth, alpha, beta, 0, false, info);
+
+            // Aborted, the last completed iteration stands
+            if (thread.stopped)
+                return;
+
+            int64_t elapsed_time = elapsed_ms();
+            int64_t nodes = total_nodes_searched();
+
+            // Upperbound
+            if (new_score <= alpha){
+                if (thread.id == 0){
+                    std::lock_guard<std::mutex> lock(output_mutex);
+                    cout << "info depth " << thread.global_depth << " seldepth " << thread.seldpeth << " time " << elapsed_time << " score cp " << alpha << " upperbound nodes " << nodes << " nps " <<   (1000 * nodes) / (elapsed_time + 1) << " hashfull " << tt.hashfull() << " pv " << uci::moveToUci(thread.root_best_move);
                     
                     Board new_board = Board(board.getFen());
-                    new_board.makeMove(root_best_move);
-                    print_tt_pv(new_board, max(global_depth - 1, 0));
+                    new_board.makeMove(thread.root_best_move);
+                    print_tt_pv(new_board, max(thread.global_depth - 1, 0));
                     cout << endl;
-
-                    beta = (alpha + beta) / 2;
-                    alpha = max(-POSITIVE_INFINITY, alpha - delta);
                 }
 
-                // Lowerbound
-                else if (new_score >= beta){
-                    cout << "info depth " << global_depth << " seldepth " << seldpeth << " time " << elapsed_time << " score cp " << beta << " lowerbound nodes " << total_nodes << " nps " <<   (1000 * total_nodes) / (elapsed_time + 1) << " hashfull " << tt.hashfull() << " pv " << uci::moveToUci(root_best_move);
+                beta = (alpha + beta) / 2;
+                alpha = max(-POSITIVE_INFINITY, alpha - delta);
+            }
+
+            // Lowerbound
+            else if (new_score >= beta){
+                if (thread.id == 0){
+                    std::lock_guard<std::mutex> lock(output_mutex);
+                    cout << "info depth " << thread.global_depth << " seldepth " << thread.seldpeth << " time " << elapsed_time << " score cp " << beta << " lowerbound nodes " << nodes << " nps " <<   (1000 * nodes) / (elapsed_time + 1) << " hashfull " << tt.hashfull() << " pv " << uci::moveToUci(thread.root_best_move);
                     
                     Board new_board = Board(board.getFen());
-                    new_board.makeMove(root_best_move);
-                    print_tt_pv(new_board, max(global_depth - 1, 0));
+                    new_board.makeMove(thread.root_best_move);
+                    print_tt_pv(new_board, max(thread.global_depth - 1, 0));
                     cout << endl;
-
-                    beta = min(POSITIVE_INFINITY, beta + delta);
                 }
 
-                // Score falls within window (exact)
-                else {
-                    cout << "info depth " << global_depth << " seldepth " << seldpeth << " time " << elapsed_time << " score cp " << new_score << " nodes " << total_nodes << " nps " <<   (1000 * total_nodes) / (elapsed_time + 1) << " hashfull " << tt.hashfull() << " pv " << uci::moveToUci(root_best_move);
+                beta = min(POSITIVE_INFINITY, beta + delta);
+            }
+
+            // Score falls within window (exact)
+            else {
+                if (thread.id == 0){
+                    std::lock_guard<std::mutex> lock(output_mutex);
+                    cout << "info depth " << thread.global_depth << " seldepth " << thread.seldpeth << " time " << elapsed_time << " score cp " << new_score << " nodes " << nodes << " nps " <<   (1000 * nodes) / (elapsed_time + 1) << " hashfull " << tt.hashfull() << " pv " << uci::moveToUci(thread.root_best_move);
                     
                     Board new_board = Board(board.getFen());
-                    new_board.makeMove(root_best_move);
-                    print_tt_pv(new_board, max(global_depth - 1, 0));
+                    new_board.makeMove(thread.root_best_move);
+                    print_tt_pv(new_board, max(thread.global_depth - 1, 0));
                     cout << endl;
-
-                    break;
                 }
 
-                // If we exceed our time management, we stop widening 
-                if (soft_bound_time_exceeded())
-                    break;
-                    
-                else delta += delta * aspiration_widening_factor.current / 100;
+                break;
             }
 
-            score = new_score;
-            root_best_score = score;
-
-            // Score stability time management
-            avg_prev_score = (avg_prev_score + root_best_score) / 2;
-            
+            // If we exceed our time management, we stop widening 
+            if (thread.id == 0 && soft_bound_time_exceeded(thread))
+                break;
+                
+            else delta += delta * aspiration_widening_factor.current / 100;
         }
+
+        score = new_score;
+        thread.root_best_score = score;
+
+        // Score stability time management
+        thread.avg_prev_score = (thread.avg_prev_score + thread.root_best_score) / 2;
     }
+}
 
-    // Hard-bound time management catch
-    catch (const SearchAbort& e) { 
-        
+// Root of the search. Every thread gets its own copy of the board, then the
+// helpers are launched (sharing only our transposition table) and the main
+// thread searches until time is up or the GUI tells us to stop
+int32_t search_root(Board &board){
+    tt.new_search();
+
+    for (auto &thread : search_threads){
+        thread->set_board(board);
+        thread->global_depth = 0;
+        thread->total_nodes = 0;
+        thread->stopped = false;
+        reset_killers(*thread);
     }
 
-    cout << "bestmove " << uci::moveToUci(root_best_move) << endl;
+    SearchThread &main_thread = *search_threads[0];
+
+    std::vector<std::thread> helpers;
+    for (size_t id = 1; id < search_threads.size(); id++)
+        helpers.emplace_back(iterative_deepening, std::ref(*search_threads[id]));
+
+    iterative_deepening(main_thread);
+
+    // We may not print our bestmove while pondering or in an infinite search
+    // until the GUI says so, even if we already ran out of depth
+    while (!stop_search && (pondering || infinite_search))
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+
+    // Main thread is done, tell the helpers to stop and wait for them
+    stop_search = true;
+    for (auto &helper : helpers)
+        helper.join();
+
+    // Expected reply to our best move from the root position
+    Move ponder_move = get_ponder_move(board, main_thread.root_best_move);
+
+    std::lock_guard<std::mutex> lock(output_mutex);
+    cout << "bestmove " << uci::moveToUci(main_thread.root_best_move);
+    if (ponder_move != Move{})
+        cout << " ponder " << uci::moveToUci(ponder_move);
+    cout << endl;
 
     return 0;
-}
\ No newline at end of file
+}
+
+// Starts searching the given position on the search thread and returns
+// immediately. The stop flag is cleared here rather than in the search
+// thread so a "stop" sent right after "go" is never lost
+void start_search(const Board &board){
+    wait_for_search();
+    stop_search = false;
+    main_search_thread = std::thread([board = Board(board)]() mutable { search_root(board); });
+}
+
+// Blocks until the current search (if any) has printed its bestmove
+void wait_for_search(){
+    if (main_search_thread.joinable())
+        main_search_thread.join();
+}
+
+// Aborts the current search (if any) and waits for its bestmove. Commands
+// that change engine state or start a new search use this rather than
+// wait_for_search, since "go infinite" only ends on a "stop" we would never
+// read while blocked
+void stop_and_wait_for_search(){
+    stop_search = true;
+    wait_for_search();
+}
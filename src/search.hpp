@@ -1,6 +1,7 @@
 #pragma once
-#include <stdexcept>
 #include <stdint.h>
+#include <atomic>
+#include <mutex>
 
 #include "chess.hpp"
 #include "search_info.hpp"
@@ -16,33 +17,17 @@ constexpr int32_t DEFAULT_BETA = POSITIVE_INFINITY;
 constexpr int32_t MAX_SEARCH_DEPTH = 128;
 constexpr int32_t MAX_SEARCH_PLY = 255;
 
-// Our custom error
-struct SearchAbort : public std::exception {
-    const char* what() const noexcept override {
-        return "Abort Search!!!! Ahhh!!";
-    }
-};
+// The main thread only reads the clock every this many nodes
+constexpr int64_t TIME_CHECK_NODES = 1024;
 
-// The global best move variable
-extern chess::Move root_best_move;
-extern chess::Move previous_best_move;
+// Per-thread search state, see search_thread.hpp
+struct SearchThread;
 
-// BM-Stability time management (https://github.com/ProgramciDusunur/Potential/commit/d1e5a2d7f03c8616abc1a2ca7779145195da3c74)
-extern int32_t bm_stability;
+// Set on "stop" and by the main thread once it is done so the helpers stop searching
+extern std::atomic<bool> stop_search;
 
-// Eval stability time management (https://github.com/ProgramciDusunur/Potential/pull/220/commits/ea410b0666d38ae05b8c66d67bc45358f35a17b8)
-extern int32_t score_stability;
-extern int32_t root_best_score;
-extern int32_t avg_prev_score;
-
-// The global depth variable
-extern int32_t global_depth;
-
-extern int64_t best_move_nodes;
-extern int64_t total_nodes_per_search;
-extern int64_t total_nodes;
-
-extern int32_t seldpeth;
+// Anything printed while a search may be running should hold this
+extern std::mutex output_mutex;
 
 // Search Function
 // We are basically using a fail soft "negamax" search, see here for more info: https://minuskelvin.net/chesswiki/content/minimax.html#negamax
@@ -50,7 +35,12 @@ extern int32_t seldpeth;
 // ply. This works because a position which is a win for white is a loss for black and vice versa. Most "strong" chess engines use
 // negamax instead of minimax because it makes the code much tidier. Not sure about how much is gains though. The "fail soft" basically
 // means we return max_value instead of alpha. This gives us more information to do puning etc etc.
-int32_t alpha_beta(chess::Board &board, int32_t depth, int32_t alpha, int32_t beta, int32_t ply, bool cut_node, SearchInfo search_info);
+int32_t alpha_beta(SearchThread &thread, int32_t depth, int32_t alpha, int32_t beta, int32_t ply, bool cut_node, SearchInfo search_info);
 
 // Root of the search function basically
 int32_t search_root(chess::Board &board);
+
+// Asynchronous search on a dedicated thread for the UCI loop
+void start_search(const chess::Board &board);
+void wait_for_search();
+void stop_and_wait_for_search();
@@ -0,0 +1,197 @@
+#pragma once
+
+#include <cstdint>
+#include <atomic>
+#include <memory>
+#include <vector>
+
+#include "chess.hpp"
+#include "search.hpp"
+#include "pawn_hash.hpp"
+#include "eval_cache.hpp"
+#include "eval.hpp"
+
+// Everything a single search thread owns. Only the transposition table is
+// shared between threads, so several of these can search at the same time
+// without any data races. Aligned to a cache line so the node counters of
+// different threads never share one
+struct alignas(64) SearchThread {
+
+    // Main thread is 0, Lazy SMP helpers are 1..n-1
+    int32_t id = 0;
+
+    // Every thread searches on its own board copy
+    chess::Board board{};
+
+    // Storing the final best move for every complete search
+    chess::Move root_best_move{};
+    chess::Move previous_best_move{};
+
+    int64_t best_move_nodes = 0;
+
+    // BM-stability
+    int32_t bm_stability = 0;
+
+    // Score stability
+    int32_t score_stability = 0;
+    int32_t avg_prev_score = 0;
+    int32_t root_best_score = 0;
+
+    int64_t total_nodes_per_search = 0;
+
+    int32_t global_depth = 0;
+
+    // Highest searched depth
+    int32_t seldpeth = 0;
+
+    // Set once this thread has to abort, every node then returns
+    // immediately so the search unwinds on its own
+    bool stopped = false;
+
+    // Static evals we took from the TT instead of evaluating, for bench
+    int64_t saved_evals = 0;
+
+    // Quiescence nodes that had to evaluate, and how many of them could
+    // stand pat on lazy_evaluate alone
+    int64_t lazy_eval_probes = 0;
+    int64_t lazy_eval_cutoffs = 0;
+
+    // Cached pawn structure evaluations
+    PawnHashTable pawn_table{};
+
+    // Cached raw static evals, sized by the EvalCache option
+    EvalCache eval_cache{};
+
+    // Eval accumulators of every position on the current search path,
+    // [accumulator_index] belongs to the current position
+    EvalAccumulator accumulators[MAX_SEARCH_PLY + 1]{};
+    int32_t accumulator_index = 0;
+
+    // Same for the network, only kept up to date while use_nnue is set
+    nnue::Accumulator nnue_accumulators[MAX_SEARCH_PLY + 1]{};
+
+    // Checkers, pins and attack maps of the same positions
+    AttackInfo attack_infos[MAX_SEARCH_PLY + 1]{};
+
+    // Atomic so other threads can read it for info output, only the
+    // owning thread ever writes to it
+    std::atomic<int64_t> total_nodes{0};
+
+    // Fail-high count for lmr [ply]
+    // Since we reset failhaigh count of ply+1, and our max ply is 255,
+    // we must have 256 + 1 = 257 elements
+    int32_t fail_high_count[257]{};
+
+    // Killers
+    chess::Move killers[2][MAX_SEARCH_PLY+1]{};
+
+    // Quiet History [color][from][to]
+    int32_t quiet_history[2][64][64]{};
+
+    // Continuation history [previous piece][target sq][curr piece][target square]
+    int32_t one_ply_conthist[12][64][12][64]{};
+    int32_t two_ply_conthist[12][64][12][64]{};
+
+    // Correction history :-)
+    // [0] -> white, [1] -> black for consistency
+    int32_t pawn_correction_history[2][16384]{};
+    int32_t non_pawn_correction_history[2][16384]{};
+    int32_t minor_correction_history[2][16384]{};
+    int32_t major_correction_history[2][16384]{};
+
+    // Sets the position to search from, always use this instead of
+    // assigning board directly so the accumulator stays in sync
+    void set_board(const chess::Board &new_board) {
+        board = new_board;
+        accumulator_index = 0;
+        accumulators[0] = accumulator_from_board(board);
+        if (use_nnue)
+            nnue::refresh(nnue_accumulators[0], board);
+        compute_checkers(board, attack_infos[0]);
+    }
+
+    const EvalAccumulator &accumulator() const {
+        return accumulators[accumulator_index];
+    }
+
+    bool in_check() const {
+        return attack_infos[accumulator_index].in_check();
+    }
+
+    // Attack info of the current position without the attack maps
+    const AttackInfo &checks_and_pins() {
+        AttackInfo &info = attack_infos[accumulator_index];
+        if (!info.has_pins)
+            compute_pins(board, info);
+        return info;
+    }
+
+    // Attack info of the current position, the attack maps are computed on
+    // first use so nodes that never evaluate don't pay for them
+    const AttackInfo &attack_info() {
+        AttackInfo &info = attack_infos[accumulator_index];
+        if (!info.has_piece_attacks)
+            compute_piece_attacks(board, info);
+        return info;
+    }
+
+    // Raw static eval of the current position, from the network or the HCE
+    int32_t evaluate() {
+        if (use_nnue)
+            return nnue::evaluate(nnue_accumulators[accumulator_index], board.sideToMove());
+        return ::evaluate(board, accumulators[accumulator_index], attack_info(), &pawn_table);
+    }
+
+    // Board::makeMove/unmakeMove plus the accumulator update, search makes
+    // every move through these
+    void make_move(chess::Move move) {
+        accumulators[accumulator_index + 1] = accumulators[accumulator_index];
+        nnue::Accumulator *nnue_acc = nullptr;
+        if (use_nnue) {
+            nnue_accumulators[accumulator_index + 1] = nnue_accumulators[accumulator_index];
+            nnue_acc = &nnue_accumulators[accumulator_index + 1];
+        }
+        accumulator_make_move(accumulators[accumulator_index + 1], nnue_acc, board, move);
+        accumulator_index++;
+        board.makeMove(move);
+        compute_checkers(board, attack_infos[accumulator_index]);
+    }
+
+    void unmake_move(chess::Move move) {
+        board.unmakeMove(move);
+        accumulator_index--;
+    }
+
+    // No pieces change, but checkers and pins are now the other side's
+    void make_null_move() {
+        accumulators[accumulator_index + 1] = accumulators[accumulator_index];
+        if (use_nnue)
+            nnue_accumulators[accumulator_index + 1] = nnue_accumulators[accumulator_index];
+        accumulator_index++;
+        board.makeNullMove();
+        compute_checkers(board, attack_infos[accumulator_index]);
+    }
+
+    void unmake_null_move() {
+        board.unmakeNullMove();
+        accumulator_index--;
+    }
+
+    int64_t nodes() const {
+        return total_nodes.load(std::memory_order_relaxed);
+    }
+
+    // Relaxed load + store instead of a locked increment, we are the only writer
+    void count_node() {
+        total_nodes.store(total_nodes.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    }
+};
+
+// All search threads, search_threads[0] is the main thread
+extern std::vector<std::unique_ptr<SearchThread>> search_threads;
+
+// Creates or destroys search threads so we have exactly count of them
+void resize_search_threads(int32_t count);
+
+// Total nodes searched by all threads
+int64_t total_nodes_searched();
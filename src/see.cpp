@@ -8,7 +8,7 @@ using namespace std;
 int32_t see_piece_values[7] = {105, 340, 312, 502, 928, 0, 0};
 
 // Estimate the value of a move
-int32_t move_estimated_value(Board &board, Move move){
+int32_t move_estimated_value(const Board &board, Move move){
 
     // Value of piece on target square
     int32_t value = see_piece_values[board.at(move.to()).type()];
@@ -32,7 +32,7 @@ int32_t move_estimated_value(Board &board, Move move){
     return value;
 }
 
-Bitboard all_attackers_to_square(Board &board, Bitboard occ, Square sq){
+Bitboard all_attackers_to_square(const Board &board, Bitboard occ, Square sq){
     return (attacks::pawn(Color::WHITE, sq) & board.us(Color::BLACK) & board.pieces(PieceType::PAWN))
         |  (attacks::pawn(Color::BLACK, sq) & board.us(Color::WHITE) & board.pieces(PieceType::PAWN))
         |  (attacks::knight(sq) & board.pieces(PieceType::KNIGHT))
@@ -43,7 +43,7 @@ Bitboard all_attackers_to_square(Board &board, Bitboard occ, Square sq){
 
 // Static Exchange Evluation
 // https://github.com/AndyGrant/Ethereal/blob/0e47e9b67f345c75eb965d9fb3e2493b6a11d09a/src/search.c#L929
-bool see(Board board, Move move, int32_t threshold){
+bool see(const Board &board, Move move, int32_t threshold){
     int32_t balance, from, to, next_victim;
     uint16_t type;
     Color turn = board.sideToMove();
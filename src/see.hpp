@@ -3,4 +3,7 @@
 #include "chess.hpp"
 
 extern int32_t see_piece_values[7];
-bool see(chess::Board board, chess::Move move, int32_t threshold);
\ No newline at end of file
+
+// Takes the board by reference and never modifies it, SEE is called for
+// most captures we search so it must not copy the board (and its history)
+bool see(const chess::Board& board, chess::Move move, int32_t threshold);
\ No newline at end of file
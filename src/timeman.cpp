@@ -1,8 +1,11 @@
 #include <chrono>
 #include <cstdint>
+#include <atomic>
 
 // Define global variables
-std::chrono::time_point<std::chrono::system_clock> search_start_time = std::chrono::system_clock::now();
+std::atomic<std::chrono::time_point<std::chrono::steady_clock>> search_start_time{std::chrono::steady_clock::now()};
+std::atomic<bool> pondering{false};
+bool infinite_search = false;
 int64_t max_soft_time_ms = 10000ll;
 int64_t max_hard_time_ms = 30000ll;
 int64_t move_overhead_ms = 0;  
\ No newline at end of file
@@ -1,79 +1,95 @@
 #pragma once
 #include <cstdint>
 #include <chrono>
+#include <atomic>
 #include "defaults.hpp"
 #include "search.hpp"
+#include "search_thread.hpp"
 
 // Time tracking
 extern int64_t max_soft_time_ms;
 extern int64_t max_hard_time_ms;
 extern int64_t move_overhead_ms;
-extern std::chrono::time_point<std::chrono::system_clock> search_start_time;
+// Atomic because "ponderhit" restarts the clock while we are searching
+extern std::atomic<std::chrono::time_point<std::chrono::steady_clock>> search_start_time;
+
+// Pondering, we ignore the time limits until "ponderhit" or "stop"
+extern std::atomic<bool> pondering;
+
+// "go infinite", we keep searching until "stop"
+extern bool infinite_search;
 
 // Get's the epased time after searching
 inline int64_t elapsed_ms() {
-    auto now = std::chrono::system_clock::now();
-    auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(now - search_start_time);
+    auto now = std::chrono::steady_clock::now();
+    auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(now - search_start_time.load(std::memory_order_relaxed));
     return elapsed.count();
 }
 
 // Returns true if elapsed time exceeds hard bound time limit
 inline bool hard_bound_time_exceeded() {
-    auto now = std::chrono::system_clock::now();
-    auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(now - search_start_time);
+    if (pondering.load(std::memory_order_relaxed))
+        return false;
+
+    auto now = std::chrono::steady_clock::now();
+    auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(now - search_start_time.load(std::memory_order_relaxed));
     return elapsed.count() > max_hard_time_ms;
 }
 
 // returns the fraction of nodes spent on best root move compared to other moves
-inline double frac_best_move_nodes(){
-    return ((double)best_move_nodes)/((double)total_nodes_per_search);
+inline double frac_best_move_nodes(const SearchThread &thread){
+    return ((double)thread.best_move_nodes)/((double)thread.total_nodes_per_search);
 }
 
 
 // Totally yoinked from Potential
-inline double get_bm_scale() {
+inline double get_bm_scale(const SearchThread &thread) {
     double best_move_scale[5] = {2.43, 1.35, 1.09, 0.88, 0.68};
-    return best_move_scale[bm_stability];
+    return best_move_scale[thread.bm_stability];
 }
 
 // Inspired by Potential's eval stability
-inline double get_score_scale() {
+inline double get_score_scale(const SearchThread &thread) {
     double score_scale[5] = {1.25, 1.15, 1.00, 0.94, 0.88};
-    return score_scale[score_stability];
+    return score_scale[thread.score_stability];
 }
 
 
 // Returns true if elapsed time exceeds soft bound time limit
-inline bool soft_bound_time_exceeded() {
-    auto now = std::chrono::system_clock::now();
-    auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(now - search_start_time);
+inline bool soft_bound_time_exceeded(SearchThread &thread) {
+    auto now = std::chrono::steady_clock::now();
+    auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(now - search_start_time.load(std::memory_order_relaxed));
 
-    double prop = frac_best_move_nodes();
+    double prop = frac_best_move_nodes(thread);
     double scale = ((double)(node_tm_base.current) / 100 - prop) * ((double)(node_tm_mul.current) / 100);
 
     // BM-Stability (https://github.com/ProgramciDusunur/Potential/commit/d1e5a2d7f03c8616abc1a2ca7779145195da3c74)
     double bm_scale = 1.0;
 
-    if (root_best_move == previous_best_move) {
-        bm_stability = std::min(bm_stability + 1, 4);
+    if (thread.root_best_move == thread.previous_best_move) {
+        thread.bm_stability = std::min(thread.bm_stability + 1, 4);
     } else {
-        bm_stability = 0;
+        thread.bm_stability = 0;
     }
 
 
     // Score stability also yoinked from Potential (https://github.com/ProgramciDusunur/Potential/pull/220/commits/ea410b0666d38ae05b8c66d67bc45358f35a17b8)
     double score_scale = 1.0;
-    if (root_best_score > avg_prev_score - 10 && root_best_score < avg_prev_score + 10){
-        score_stability = std::min(score_stability + 1, 4);
+    if (thread.root_best_score > thread.avg_prev_score - 10 && thread.root_best_score < thread.avg_prev_score + 10){
+        thread.score_stability = std::min(thread.score_stability + 1, 4);
     }
     else {
-        score_stability = 0;
+        thread.score_stability = 0;
     }
 
-    if (global_depth >= 7) {
-        bm_scale = get_bm_scale();
-        score_scale = get_score_scale();
+    if (thread.global_depth >= 7) {
+        bm_scale = get_bm_scale(thread);
+        score_scale = get_score_scale(thread);
     }
     
+    // Keep the stability counters going while pondering, but never stop
+    if (pondering.load(std::memory_order_relaxed))
+        return false;
+
     return elapsed.count() >= (int64_t)((double)max_soft_time_ms * scale * bm_scale * score_scale);
 }
\ No newline at end of file
@@ -1,4 +1,425 @@
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <new>
+#include <string>
+#include <thread>
+#include <vector>
+
+#if defined(__linux__)
+#include <sys/syscall.h>
+#endif
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#if defined(_WIN32)
+#include <malloc.h>
+#endif
+
 #include "transposition.hpp"
 
 // Global transposition table
 TranspositionTable tt(64);
+
+constexpr size_t HUGE_PAGE_SIZE = 2 * 1024 * 1024;
+
+// Start of a shared memory table, the clusters follow. Whoever creates the
+// segment publishes its size here, everyone else waits for the magic. The
+// search generation is shared too, see TranspositionTable::generation
+struct alignas(64) SharedTTHeader {
+    std::atomic<uint64_t> magic;
+    uint64_t cluster_count;
+    std::atomic<uint8_t> generation;
+};
+
+static_assert(sizeof(SharedTTHeader) == 64, "Shared TT clusters must stay cache line aligned");
+
+constexpr uint64_t SHARED_TT_MAGIC = 0x5745414B53484D31ull; // "WEAKSHM1"
+
+#if defined(__linux__)
+
+// From linux/mempolicy.h, which isn't always installed
+constexpr int32_t MPOL_INTERLEAVE_POLICY = 3;
+
+// Spreads the pages of [ptr, ptr + bytes) round robin over every online NUMA
+// node. Searching threads run on all nodes and probe the whole table, so
+// interleaving beats having every page on the node of whoever touched it
+// first. Does nothing on single node machines. We talk to the kernel
+// directly so we don't need libnuma
+static void interleave_numa_nodes(void* ptr, size_t bytes){
+    std::ifstream online("/sys/devices/system/node/online");
+    std::string ranges;
+    if (!(online >> ranges))
+        return;
+
+    // Format is a list of ranges like "0-1,3"
+    unsigned long mask = 0;
+    int32_t node_count = 0;
+    size_t pos = 0;
+    while (pos < ranges.size()){
+        size_t end = ranges.find(',', pos);
+        if (end == std::string::npos)
+            end = ranges.size();
+
+        std::string range = ranges.substr(pos, end - pos);
+        size_t dash = range.find('-');
+        int32_t first = std::stoi(range.substr(0, dash));
+        int32_t last = dash == std::string::npos ? first : std::stoi(range.substr(dash + 1));
+        for (int32_t node = first; node <= last && node < 64; node++){
+            mask |= 1ul << node;
+            node_count++;
+        }
+        pos = end + 1;
+    }
+
+    if (node_count < 2)
+        return;
+
+    syscall(SYS_mbind, ptr, bytes, MPOL_INTERLEAVE_POLICY, &mask, sizeof(mask) * 8, 0);
+}
+
+#endif
+
+// Allocates the table on 2MB pages when we can. A probe is a random access
+// into a table of up to 16GB, with 4KB pages nearly every probe is also a
+// TLB miss. Explicit huge pages need to be reserved by the admin, if there
+// are none we fall back to aligned memory and ask for transparent huge pages
+void TranspositionTable::allocate(size_t bytes){
+    allocated_bytes = (bytes + HUGE_PAGE_SIZE - 1) / HUGE_PAGE_SIZE * HUGE_PAGE_SIZE;
+    explicit_huge_pages = false;
+    void* ptr = nullptr;
+
+#if defined(__linux__)
+    ptr = mmap(nullptr, allocated_bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+    if (ptr == MAP_FAILED)
+        ptr = nullptr;
+    else
+        explicit_huge_pages = true;
+#endif
+
+    if (!ptr){
+#if defined(_WIN32)
+        ptr = _aligned_malloc(allocated_bytes, HUGE_PAGE_SIZE);
+#else
+        ptr = std::aligned_alloc(HUGE_PAGE_SIZE, allocated_bytes);
+#endif
+    }
+
+    if (!ptr)
+        throw std::bad_alloc();
+
+#if defined(__linux__) && defined(MADV_HUGEPAGE)
+    if (!explicit_huge_pages)
+        madvise(ptr, allocated_bytes, MADV_HUGEPAGE);
+#endif
+
+#if defined(__linux__)
+    interleave_numa_nodes(ptr, allocated_bytes);
+#endif
+
+    table = static_cast<TTCluster*>(ptr);
+}
+
+void TranspositionTable::release(){
+    if (!table)
+        return;
+
+#if defined(__unix__) || defined(__APPLE__)
+    if (shared)
+        munmap(reinterpret_cast<char*>(table) - sizeof(SharedTTHeader), allocated_bytes);
+    else
+#endif
+#if defined(__linux__)
+    if (explicit_huge_pages)
+        munmap(table, allocated_bytes);
+    else
+        std::free(table);
+#elif defined(_WIN32)
+    _aligned_free(table);
+#else
+    std::free(table);
+#endif
+
+    table = nullptr;
+    size = 0;
+    allocated_bytes = 0;
+    shared = false;
+    generation = &local_generation;
+}
+
+// Nothing is backed by real memory until it's first written to, so after an
+// allocation constructing the clusters is where all the page faults happen.
+// Splitting it over our search threads makes that parallel, and without an
+// interleave policy every page lands on the node of the thread that touched
+// it first. Constructing over existing clusters is how we clear them
+void TranspositionTable::zero_clusters(int32_t thread_count){
+    thread_count = std::max(thread_count, 1);
+    size_t chunk = (size + thread_count - 1) / thread_count;
+    auto construct = [this, chunk](int32_t id){
+        size_t begin = std::min(size, chunk * id);
+        size_t end = std::min(size, begin + chunk);
+        for (size_t i = begin; i < end; i++)
+            new (&table[i]) TTCluster{};
+    };
+
+    std::vector<std::thread> workers;
+    for (int32_t id = 1; id < thread_count; id++)
+        workers.emplace_back(construct, id);
+    construct(0);
+    for (auto &worker : workers)
+        worker.join();
+}
+
+void TranspositionTable::clear(int32_t thread_count){
+    zero_clusters(thread_count);
+    generation->store(0, std::memory_order_relaxed);
+}
+
+void TranspositionTable::clear_static_evals(){
+    for (size_t i = 0; i < size; i++){
+        for (int32_t j = 0; j < TT_CLUSTER_SIZE; j++){
+            uint64_t data = table[i].data[j].load(std::memory_order_relaxed);
+            uint16_t key_slot = table[i].keys[j].load(std::memory_order_relaxed);
+            tt_packing::forget_static_eval(data, key_slot);
+            table[i].data[j].store(data, std::memory_order_relaxed);
+            table[i].keys[j].store(key_slot, std::memory_order_relaxed);
+        }
+    }
+}
+
+void TranspositionTable::resize(size_t mb, int32_t thread_count){
+    release();
+
+    size = std::max<size_t>((mb * 1024 * 1024) / sizeof(TTCluster), 1);
+    allocate(size * sizeof(TTCluster));
+    clear(thread_count);
+}
+
+void TranspositionTable::clear_async(int32_t thread_count){
+    wait_until_ready();
+    pending = std::thread([this, thread_count]() { clear(thread_count); });
+}
+
+void TranspositionTable::resize_async(size_t mb, int32_t thread_count){
+    wait_until_ready();
+    pending = std::thread([this, mb, thread_count]() { resize(mb, thread_count); });
+}
+
+void TranspositionTable::wait_until_ready(){
+    if (pending.joinable())
+        pending.join();
+}
+
+// Layout of a saved table: this header followed by the raw clusters. The
+// clusters are written as-is, so files only work on machines with the same
+// endianness, which is all of ours
+struct TTFileHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t generation;
+    uint64_t cluster_count;
+};
+
+constexpr char TT_FILE_MAGIC[8] = {'W', 'E', 'A', 'K', 'H', 'A', 'S', 'H'};
+constexpr uint32_t TT_FILE_VERSION = 1;
+
+// Plain copy of a cluster for file IO
+struct TTClusterImage {
+    uint64_t data[TT_CLUSTER_SIZE];
+    uint16_t keys[TT_CLUSTER_SIZE];
+    uint8_t padding[4];
+};
+
+static_assert(sizeof(TTClusterImage) == sizeof(TTCluster), "TT cluster images must match clusters");
+
+// Clusters are copied out with atomic loads a chunk at a time, so other
+// threads can keep searching while we save. Entries torn by a concurrent
+// store still fail verification when they are loaded back
+bool TranspositionTable::save(const std::string& path) const {
+    FILE* file = std::fopen(path.c_str(), "wb");
+    if (!file)
+        return false;
+
+    TTFileHeader header{};
+    std::memcpy(header.magic, TT_FILE_MAGIC, sizeof(TT_FILE_MAGIC));
+    header.version = TT_FILE_VERSION;
+    header.generation = current_generation();
+    header.cluster_count = size;
+    bool ok = std::fwrite(&header, sizeof(header), 1, file) == 1;
+
+    constexpr size_t CHUNK = 16384;
+    std::vector<TTClusterImage> buffer(CHUNK);
+    for (size_t begin = 0; ok && begin < size; begin += CHUNK){
+        size_t count = std::min(CHUNK, size - begin);
+        for (size_t i = 0; i < count; i++){
+            const TTCluster& cluster = table[begin + i];
+            for (int32_t j = 0; j < TT_CLUSTER_SIZE; j++){
+                buffer[i].data[j] = cluster.data[j].load(std::memory_order_relaxed);
+                buffer[i].keys[j] = cluster.keys[j].load(std::memory_order_relaxed);
+            }
+        }
+        ok = std::fwrite(buffer.data(), sizeof(TTClusterImage), count, file) == count;
+    }
+
+    return std::fclose(file) == 0 && ok;
+}
+
+// The file is mapped rather than read, so we copy straight from the page
+// cache into the table without staging a multi GB buffer
+bool TranspositionTable::load(const std::string& path, int32_t thread_count){
+#if defined(__unix__) || defined(__APPLE__)
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+        return false;
+
+    struct stat info{};
+    if (fstat(fd, &info) != 0 || static_cast<size_t>(info.st_size) < sizeof(TTFileHeader)){
+        close(fd);
+        return false;
+    }
+
+    size_t file_size = static_cast<size_t>(info.st_size);
+    void* mapping = mmap(nullptr, file_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (mapping == MAP_FAILED)
+        return false;
+
+    madvise(mapping, file_size, MADV_SEQUENTIAL);
+    const char* bytes = static_cast<const char*>(mapping);
+#else
+    FILE* file = std::fopen(path.c_str(), "rb");
+    if (!file)
+        return false;
+
+    std::vector<char> contents;
+    char chunk[65536];
+    size_t read = 0;
+    while ((read = std::fread(chunk, 1, sizeof(chunk), file)) > 0)
+        contents.insert(contents.end(), chunk, chunk + read);
+    std::fclose(file);
+
+    size_t file_size = contents.size();
+    const char* bytes = contents.data();
+#endif
+
+    TTFileHeader header{};
+    if (file_size >= sizeof(header))
+        std::memcpy(&header, bytes, sizeof(header));
+
+    constexpr size_t CLUSTERS_PER_MB = 1024 * 1024 / sizeof(TTCluster);
+    bool valid = file_size >= sizeof(header)
+              && std::memcmp(header.magic, TT_FILE_MAGIC, sizeof(TT_FILE_MAGIC)) == 0
+              && header.version == TT_FILE_VERSION
+              && header.cluster_count > 0
+              && header.cluster_count % CLUSTERS_PER_MB == 0
+              && header.cluster_count <= file_size / sizeof(TTClusterImage)
+              && file_size == sizeof(header) + header.cluster_count * sizeof(TTClusterImage)
+              && (!shared || header.cluster_count == size); // Other processes rely on its size
+
+    if (valid){
+        if (header.cluster_count != size)
+            resize(header.cluster_count / CLUSTERS_PER_MB, thread_count);
+
+        const TTClusterImage* images = reinterpret_cast<const TTClusterImage*>(bytes + sizeof(header));
+        for (size_t i = 0; i < size; i++){
+            for (int32_t j = 0; j < TT_CLUSTER_SIZE; j++){
+                // The file may have been written with a different evaluation,
+                // so its stored evals can't be trusted. Everything else can
+                uint64_t data = images[i].data[j];
+                uint16_t key_slot = images[i].keys[j];
+                tt_packing::forget_static_eval(data, key_slot);
+                table[i].data[j].store(data, std::memory_order_relaxed);
+                table[i].keys[j].store(key_slot, std::memory_order_relaxed);
+            }
+        }
+        generation->store(static_cast<uint8_t>(header.generation), std::memory_order_relaxed);
+    }
+
+#if defined(__unix__) || defined(__APPLE__)
+    munmap(mapping, file_size);
+#endif
+
+    return valid;
+}
+
+// Cooperating processes all map the same segment and probe and store into
+// it exactly like threads do. Entries are verified against their key XOR
+// data, so a write torn by another process just reads as a miss. Every
+// process bumps the generation in the header when it starts a search, so
+// entries age with whichever process searches. Segments are only open to
+// our own user and live on until they are removed (rm /dev/shm/<name> on
+// Linux), so a table outlives its processes
+bool TranspositionTable::attach_shared(const std::string& name, size_t mb){
+#if defined(__unix__) || defined(__APPLE__)
+    std::string shm_name = name[0] == '/' ? name : "/" + name;
+
+    int fd = shm_open(shm_name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600);
+    bool creator = fd >= 0;
+    if (!creator)
+        fd = shm_open(shm_name.c_str(), O_RDWR, 0600);
+    if (fd < 0)
+        return false;
+
+    size_t cluster_count = std::max<size_t>((mb * 1024 * 1024) / sizeof(TTCluster), 1);
+    size_t bytes = sizeof(SharedTTHeader) + cluster_count * sizeof(TTCluster);
+
+    // Freshly truncated memory reads as zeros, which is an empty table
+    if (creator && ftruncate(fd, bytes) != 0){
+        close(fd);
+        shm_unlink(shm_name.c_str());
+        return false;
+    }
+
+    // Give the creator a moment to size the segment
+    struct stat info{};
+    for (int32_t tries = 0; !creator && tries < 1000; tries++){
+        if (fstat(fd, &info) == 0 && static_cast<size_t>(info.st_size) >= sizeof(SharedTTHeader) + sizeof(TTCluster))
+            break;
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    if (!creator)
+        bytes = static_cast<size_t>(info.st_size);
+
+    void* mapping = bytes > sizeof(SharedTTHeader) ? mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0) : MAP_FAILED;
+    close(fd);
+    if (mapping == MAP_FAILED)
+        return false;
+
+    SharedTTHeader* header = static_cast<SharedTTHeader*>(mapping);
+    if (creator){
+        header->cluster_count = cluster_count;
+        header->magic.store(SHARED_TT_MAGIC, std::memory_order_release);
+    }
+    else {
+        for (int32_t tries = 0; header->magic.load(std::memory_order_acquire) != SHARED_TT_MAGIC && tries < 1000; tries++)
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+
+        if (header->magic.load(std::memory_order_acquire) != SHARED_TT_MAGIC
+            || sizeof(SharedTTHeader) + header->cluster_count * sizeof(TTCluster) > bytes){
+            munmap(mapping, bytes);
+            return false;
+        }
+        cluster_count = header->cluster_count;
+    }
+
+    wait_until_ready();
+    release();
+    table = reinterpret_cast<TTCluster*>(static_cast<char*>(mapping) + sizeof(SharedTTHeader));
+    size = cluster_count;
+    allocated_bytes = bytes;
+    shared = true;
+    generation = &header->generation;
+    return true;
+#else
+    (void)name;
+    (void)mb;
+    return false;
+#endif
+}
\ No newline at end of file
@@ -1,7 +1,10 @@
 #pragma once
 #include <cstdint>
-#include <vector>
 #include <limits>
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <string>
 
 #include "chess.hpp"
 
@@ -15,66 +18,301 @@ enum class NodeType : uint8_t {
     NONE
 };
 
-// Single TT Entry
+// Single TT Entry, unpacked. This is what probe hands out, the table
+// itself only stores the packed form below
 struct TTEntry {
     uint64_t key = 0; // Zobrist hash
-    int32_t score = 0; // Score 
+    int32_t score = 0; // Score
+    int32_t static_eval = 0; // Raw static evaluation, EVAL_NONE if unknown
     int32_t depth = -1; // Depth
     NodeType type = NodeType::NONE;
     uint16_t best_move = 0; // Encoded move
     bool tt_was_pv = false;
 };
 
+// Everything but the key is packed into a single 64 bit word:
+//
+//  bits  0-15  best move
+//  bits 16-32  score (signed, 17 bits since mate scores don't fit in 16)
+//  bits 33-47  raw static eval (signed, 15 bits)
+//  bits 48-55  depth + 1, so 0 means the slot is empty
+//  bits 56-57  node type
+//  bit  58     was pv
+//  bits 59-63  age (search generation)
+namespace tt_packing {
+    constexpr int32_t SCORE_SHIFT = 16;
+    constexpr int32_t EVAL_SHIFT = 33;
+    constexpr int32_t DEPTH_SHIFT = 48;
+    constexpr int32_t TYPE_SHIFT = 56;
+    constexpr int32_t PV_SHIFT = 58;
+    constexpr int32_t AGE_SHIFT = 59;
+
+    constexpr int32_t SCORE_BITS = 17;
+    constexpr int32_t EVAL_BITS = 15;
+    constexpr int32_t MAX_EVAL = (1 << (EVAL_BITS - 1)) - 1;
+
+    // Evals that don't fit are stored as unknown rather than clamped, so
+    // reusing a stored eval always gives the same result as evaluating
+    constexpr int32_t EVAL_NONE = -MAX_EVAL - 1;
+    constexpr int32_t MAX_DEPTH = 254;
+    constexpr uint8_t AGE_MASK = 31;
+
+    inline int32_t sign_extend(uint64_t value, int32_t bits) {
+        return static_cast<int32_t>(static_cast<int64_t>(value << (64 - bits)) >> (64 - bits));
+    }
+
+    inline uint64_t pack(int32_t score, int32_t static_eval, int32_t depth, NodeType type, uint16_t best_move, bool tt_was_pv, uint8_t age) {
+        if (static_eval < -MAX_EVAL || static_eval > MAX_EVAL)
+            static_eval = EVAL_NONE;
+        depth = std::clamp(depth, 0, MAX_DEPTH);
+        return static_cast<uint64_t>(best_move)
+             | ((static_cast<uint64_t>(score) & ((1ull << SCORE_BITS) - 1)) << SCORE_SHIFT)
+             | ((static_cast<uint64_t>(static_eval) & ((1ull << EVAL_BITS) - 1)) << EVAL_SHIFT)
+             | (static_cast<uint64_t>(depth + 1) << DEPTH_SHIFT)
+             | (static_cast<uint64_t>(type) << TYPE_SHIFT)
+             | (static_cast<uint64_t>(tt_was_pv) << PV_SHIFT)
+             | (static_cast<uint64_t>(age & AGE_MASK) << AGE_SHIFT);
+    }
+
+    inline uint16_t best_move(uint64_t data) { return static_cast<uint16_t>(data); }
+    inline int32_t score(uint64_t data) { return sign_extend(data >> SCORE_SHIFT, SCORE_BITS); }
+    inline int32_t static_eval(uint64_t data) { return sign_extend(data >> EVAL_SHIFT, EVAL_BITS); }
+    inline int32_t depth(uint64_t data) { return static_cast<int32_t>((data >> DEPTH_SHIFT) & 0xFF) - 1; }
+    inline NodeType type(uint64_t data) { return static_cast<NodeType>((data >> TYPE_SHIFT) & 3); }
+    inline bool tt_was_pv(uint64_t data) { return (data >> PV_SHIFT) & 1; }
+    inline uint8_t age(uint64_t data) { return static_cast<uint8_t>(data >> AGE_SHIFT); }
+    inline bool empty(uint64_t data) { return ((data >> DEPTH_SHIFT) & 0xFF) == 0; }
+
+    // The key slot holds the partial key XORed with a fold of the data word.
+    // Key and data are separate atomic words, so another thread can write
+    // one of them in between our two loads. A key/data pair from two
+    // different stores then fails verification instead of handing out a
+    // score or move that belongs to another position
+    inline uint16_t fold(uint64_t data) {
+        return static_cast<uint16_t>(data ^ (data >> 16) ^ (data >> 32) ^ (data >> 48));
+    }
+
+    // Marks the static eval of a stored entry as unknown, rewriting its key
+    // slot so the pair still verifies
+    inline void forget_static_eval(uint64_t& data, uint16_t& key_slot) {
+        if (empty(data))
+            return;
+
+        constexpr uint64_t eval_mask = ((1ull << EVAL_BITS) - 1) << EVAL_SHIFT;
+        uint64_t new_data = (data & ~eval_mask) | ((static_cast<uint64_t>(EVAL_NONE) << EVAL_SHIFT) & eval_mask);
+        key_slot ^= fold(data) ^ fold(new_data);
+        data = new_data;
+    }
+}
+
+// 6 entries in exactly one cache line, so a probe touches a single line.
+// Each entry is a 16 bit partial key plus its 64 bit data word, 10 bytes
+// instead of the 24 bytes a padded TTEntry takes up. All threads share the
+// table without locks, every access is a relaxed atomic load or store
+constexpr int32_t TT_CLUSTER_SIZE = 6;
+
+struct alignas(64) TTCluster {
+    std::atomic<uint64_t> data[TT_CLUSTER_SIZE]{};
+    std::atomic<uint16_t> keys[TT_CLUSTER_SIZE]{};
+    uint8_t padding[4]{};
+};
+
+static_assert(sizeof(TTCluster) == 64, "TT clusters must be exactly one cache line");
+static_assert(std::atomic<uint64_t>::is_always_lock_free, "TT entries must be lock free");
+
 // Transposition table class
 class TranspositionTable {
-    std::vector<TTEntry> table;
-    size_t size;
+    TTCluster* table = nullptr;
+    size_t size = 0;
+
+    // Bytes actually allocated (rounded up to whole huge pages) and whether
+    // they came from explicit huge pages, which have to be unmapped
+    size_t allocated_bytes = 0;
+    bool explicit_huge_pages = false;
+
+    // Mapped from a named shared memory segment, see attach_shared
+    bool shared = false;
+
+    // Bumped every search, entries from older searches get replaced first.
+    // Points into the segment header when shared, so every process ages
+    // entries by the same clock
+    std::atomic<uint8_t> local_generation{0};
+    std::atomic<uint8_t>* generation = &local_generation;
+
+    // Multiply-shift instead of modulo, maps the key onto [0, size) using its
+    // high bits. The low 16 bits are the partial key stored in the entry
+    size_t index(uint64_t key) const {
+        return static_cast<size_t>((static_cast<unsigned __int128>(key) * size) >> 64);
+    }
+
+    uint8_t current_generation() const {
+        return generation->load(std::memory_order_relaxed);
+    }
+
+    // How many searches ago an entry was written
+    int32_t relative_age(uint64_t data, uint8_t current) const {
+        return (current - tt_packing::age(data)) & tt_packing::AGE_MASK;
+    }
+
+    // Clear or resize running in the background, see clear_async
+    std::thread pending;
+
+    void allocate(size_t bytes);
+    void release();
+
+    // (Re)constructs every cluster, split over thread_count threads
+    void zero_clusters(int32_t thread_count);
 
 public:
     TranspositionTable(size_t mb = 64) {
-        size = (mb * 1024 * 1024) / sizeof(TTEntry);
-        table.resize(size);
+        resize(mb);
+    }
+
+    ~TranspositionTable() {
+        wait_until_ready();
+        release();
     }
 
-    void clear() {
-        std::fill(table.begin(), table.end(), TTEntry{});
+    TranspositionTable(const TranspositionTable&) = delete;
+    TranspositionTable& operator=(const TranspositionTable&) = delete;
+
+    // Zeroes the table using thread_count threads
+    void clear(int32_t thread_count = 1);
+
+    // Reallocates the table and zeroes it using thread_count threads
+    void resize(size_t mb, int32_t thread_count = 1);
+
+    // Same as above, but on a background thread so the GUI doesn't have to
+    // wait for multi GB tables between games. Nothing may probe or store
+    // until wait_until_ready() returns
+    void clear_async(int32_t thread_count);
+    void resize_async(size_t mb, int32_t thread_count);
+
+    // Blocks until a background clear or resize is done
+    void wait_until_ready();
+
+    // Marks every stored static eval as unknown but keeps the entries, for
+    // when the evaluation changes. Nothing may be searching
+    void clear_static_evals();
+
+    // Replaces our table with the named POSIX shared memory segment, creating
+    // it with mb MB if no other process has yet. Otherwise we take the size
+    // it was created with. Returns false if shared memory isn't available
+    bool attach_shared(const std::string& name, size_t mb);
+
+    bool is_shared() const {
+        return shared;
     }
 
-    void resize(size_t mb) {
-        size = (mb * 1024 * 1024) / sizeof(TTEntry);
-        table.clear();
-        table.resize(size);
+    // Table size in MB, as set by resize() or load()
+    size_t size_mb() const {
+        return size * sizeof(TTCluster) / (1024 * 1024);
     }
 
-    void store(uint64_t key, int32_t score, int32_t depth, NodeType type, uint16_t best_move, bool tt_was_pv) {
-        size_t index = key % size;
-        TTEntry& entry = table[index];
+    // Writes the table to a binary file, safe to call while searching
+    bool save(const std::string& path) const;
+
+    // Reads a table written by save(), resizing to its size if needed.
+    // Nothing may be searching while we load
+    bool load(const std::string& path, int32_t thread_count);
+
+    // Pulls the cluster of a position we are about to probe into the cache,
+    // so the miss overlaps with whatever work comes before the probe
+    void prefetch(uint64_t key) const {
+#if defined(__GNUC__)
+        __builtin_prefetch(&table[index(key)]);
+#endif
+    }
 
-        if (entry.key == 0 || entry.depth <= depth) {
-            entry = TTEntry{ key, score, depth, type, best_move, tt_was_pv };
+    // Called once at the start of every search. The counter wraps at 256,
+    // a multiple of the age range, so it is only masked where it's used
+    void new_search() {
+        generation->fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void store(uint64_t key, int32_t score, int32_t static_eval, int32_t depth, NodeType type, uint16_t best_move, bool tt_was_pv) {
+        TTCluster& cluster = table[index(key)];
+        uint16_t key16 = static_cast<uint16_t>(key);
+        uint8_t current = current_generation();
+
+        // Processes sharing a table may run different builds or evaluations,
+        // so raw evals are only kept in a private table
+        if (shared)
+            static_eval = tt_packing::EVAL_NONE;
+
+        // Same position if we have it, otherwise the least valuable entry:
+        // empty slots first, then shallow entries from old searches
+        int32_t replace = 0;
+        uint64_t old_data = 0;
+        bool same_position = false;
+        int32_t worst_value = std::numeric_limits<int32_t>::max();
+        for (int32_t i = 0; i < TT_CLUSTER_SIZE; i++) {
+            uint64_t data = cluster.data[i].load(std::memory_order_relaxed);
+            uint16_t stored_key = cluster.keys[i].load(std::memory_order_relaxed);
+
+            if (tt_packing::empty(data) || (stored_key ^ tt_packing::fold(data)) == key16) {
+                replace = i;
+                old_data = data;
+                same_position = !tt_packing::empty(data);
+                break;
+            }
+
+            int32_t value = tt_packing::depth(data) - 8 * relative_age(data, current);
+            if (value < worst_value) {
+                worst_value = value;
+                replace = i;
+                old_data = data;
+            }
         }
+
+        // Keep the old best move rather than forgetting it
+        if (same_position && best_move == 0)
+            best_move = tt_packing::best_move(old_data);
+
+        // Don't overwrite a deeper search of the same position from this
+        // search with a much shallower one, unless it's an exact score
+        if (same_position
+            && type != NodeType::EXACT
+            && relative_age(old_data, current) == 0
+            && depth + 2 * tt_was_pv < tt_packing::depth(old_data) - 3)
+            return;
+
+        uint64_t data = tt_packing::pack(score, static_eval, depth, type, best_move, tt_was_pv, current);
+        cluster.data[replace].store(data, std::memory_order_relaxed);
+        cluster.keys[replace].store(key16 ^ tt_packing::fold(data), std::memory_order_relaxed);
     }
 
     bool probe(uint64_t key, TTEntry& out) const {
-        const TTEntry& entry = table[key % size];
-        if (entry.key == key) {
-            out = entry;
-            return true;
+        const TTCluster& cluster = table[index(key)];
+        uint16_t key16 = static_cast<uint16_t>(key);
+
+        for (int32_t i = 0; i < TT_CLUSTER_SIZE; i++) {
+            uint64_t data = cluster.data[i].load(std::memory_order_relaxed);
+            uint16_t stored_key = cluster.keys[i].load(std::memory_order_relaxed);
+            if ((stored_key ^ tt_packing::fold(data)) == key16 && !tt_packing::empty(data)) {
+                out = TTEntry{ key, tt_packing::score(data), tt_packing::static_eval(data), tt_packing::depth(data),
+                               tt_packing::type(data), tt_packing::best_move(data), tt_packing::tt_was_pv(data) };
+                return true;
+            }
         }
         return false;
     }
 
+    // Permill of entries written during the current search
     int32_t hashfull() const {
         int32_t fill = 0;
         size_t probe_limit = std::min(size, size_t(1000));
+        uint8_t current = current_generation();
 
         for (size_t i = 0; i < probe_limit; ++i) {
-            if (table[i].type != NodeType::NONE) {
-                ++fill;
+            for (int32_t j = 0; j < TT_CLUSTER_SIZE; j++) {
+                uint64_t data = table[i].data[j].load(std::memory_order_relaxed);
+                if (!tt_packing::empty(data) && relative_age(data, current) == 0)
+                    ++fill;
             }
         }
-        return fill;
+        return fill * 1000 / (static_cast<int32_t>(probe_limit) * TT_CLUSTER_SIZE);
     }
 };
 
-extern TranspositionTable tt;
\ No newline at end of file
+extern TranspositionTable tt;
@@ -7,6 +7,7 @@
 #include <string>
 #include <sstream>
 #include <vector>
+#include <algorithm>
 
 #include "chess.hpp"
 #include "uci.hpp"
@@ -17,13 +18,66 @@
 #include "see.hpp"
 #include "defaults.hpp"
 #include "bench.hpp"
+#include "search_thread.hpp"
 #include "history.hpp"
+#include "nnue.hpp"
 
 #define IS_TUNING 0
 
 using namespace std;
 using namespace chess;
 
+// Saved TT to load at startup and on every new game, empty for none
+const string HASH_FILE_OPTION = "HashFile";
+string hash_file;
+
+// Name of a shared memory TT to share with other processes, empty for none
+const string SHARED_HASH_OPTION = "SharedHash";
+
+// Network file for NNUE evaluation, "<embedded>" is the one built in with
+// make EVALFILE=<net>, if any
+const string EVAL_FILE_OPTION = "EvalFile";
+const string USE_NNUE_OPTION = "UseNNUE";
+
+// Cached raw evals are no longer valid once the evaluation changes, neither
+// in the eval caches nor in the TT
+void clear_eval_caches(){
+    for (auto &thread : search_threads)
+        thread->eval_cache.clear();
+    tt.wait_until_ready();
+    tt.clear_static_evals();
+}
+
+// Loads a network file (or the embedded one) and reports how it went
+bool load_eval_file(const string &path){
+    bool loaded = path == "<embedded>" ? nnue::load_embedded() : nnue::load(path);
+    if (loaded){
+        clear_eval_caches();
+        cout << "info string loaded network " << path << endl;
+    }
+    else
+        cout << "info string could not load network " << path << endl;
+    return loaded;
+}
+
+// Joins words[first..] back together, for file names with spaces
+string join_words(const vector<string> &words, size_t first){
+    string joined;
+    for (size_t i = first; i < words.size(); i++)
+        joined += (i > first ? " " : "") + words[i];
+    return joined;
+}
+
+// Loads a saved TT and reports how it went
+void load_hash_file(const string &path){
+    if (tt.load(path, threads.current)){
+        tt_size.set(tt.size_mb());
+        cout << "info string loaded hash from " << path << " (" << tt.size_mb() << " MB)" << endl;
+    }
+    else
+        cout << "info string could not load hash from " << path << endl;
+}
+
 // Process UCI Commands
 // For basic SPRT functionality, we only need to implement these
 
@@ -156,12 +210,36 @@ void print_board(const Board &board){
 // Main UCI loop
 int32_t main(int32_t argc, char* argv[]) {
 
+    // Allocate our search threads (there is always at least the main one)
+    resize_search_threads(threads.current);
+
+    // A build with an embedded network evaluates with it by default
+    use_nnue = nnue::load_embedded();
+
     if (argc > 1) {
         string command = argv[1];
+
+        // "bench <network>" benches with that network instead of the default
         if (command == "bench") {
+            if (argc > 2 && !(use_nnue = nnue::load(argv[2]))){
+                cout << "could not load network " << argv[2] << endl;
+                return 1;
+            }
             bench(BENCH_DEPTH);
             return 0;
         } 
+        else if (command == "seebench") {
+            see_bench(SEE_BENCH_ITERATIONS);
+            return 0;
+        }
+        else if (command == "evalbench") {
+            eval_bench(EVAL_BENCH_ITERATIONS);
+            return 0;
+        }
+        else if (command == "ttstress") {
+            tt_stress(argc > 2 ? stoi(argv[2]) : 4, TT_STRESS_OPERATIONS);
+            return 0;
+        }
     } 
 
     string input;
@@ -193,6 +271,21 @@ int32_t main(int32_t argc, char* argv[]) {
                 tt_size.print_uci_option();
                 threads.print_uci_option();
                 move_overhead.print_uci_option();
+                eval_cache_size.print_uci_option();
+
+                // GUIs only send "go ponder" when this is enabled, the
+                // search itself doesn't need to know
+                cout << "option name Ponder type check default false\n";
+
+                // Warm starts for analysis, see save_hash / load_hash
+                cout << "option name " << HASH_FILE_OPTION << " type string default <empty>\n";
+
+                // Shares the TT with every other process using the same name
+                cout << "option name " << SHARED_HASH_OPTION << " type string default <empty>\n";
+
+                // NNUE instead of the HCE, needs a network from EvalFile
+                cout << "option name " << EVAL_FILE_OPTION << " type string default " << (nnue::has_embedded() ? "<embedded>" : "<empty>") << "\n";
+                cout << "option name " << USE_NNUE_OPTION << " type check default " << (use_nnue ? "true" : "false") << "\n";
             }
             cout << "uciok\n";
         }
@@ -201,15 +294,36 @@ int32_t main(int32_t argc, char* argv[]) {
         // "ucinewgame" or when our engine crashes/doesn't respond for
         // a long while. Otherwise, "isready" is called right after the 
         // first "uci" to our engine. We must always reply with "readyok"
-        // to "isready".
-        else if (words[0] == "isready")
-            cout << "readyok\n";
+        // to "isready". A clear or resize of the TT may still be running in
+        // the background, we are only ready once it's done
+        else if (words[0] == "isready"){
+            tt.wait_until_ready();
+            std::lock_guard<std::mutex> lock(output_mutex);
+            cout << "readyok" << endl;
+        }
+
+        // Stop searching as soon as possible and print bestmove. This works
+        // because the search runs on its own thread
+        else if (words[0] == "stop")
+            stop_and_wait_for_search();
 
         else if (words[0] == "ucinewgame"){
-            tt.clear();
-            reset_continuation_history();
-            reset_correction_history();
-            reset_quiet_history();
+            stop_and_wait_for_search();
+
+            // Start every game from the saved table instead of an empty one.
+            // A shared table is never cleared, other processes are using it
+            if (!hash_file.empty()){
+                tt.wait_until_ready();
+                load_hash_file(hash_file);
+            }
+            else if (!tt.is_shared())
+                tt.clear_async(threads.current);
+            for (auto &thread : search_threads){
+                reset_continuation_history(*thread);
+                reset_correction_history(*thread);
+                reset_quiet_history(*thread);
+                thread->eval_cache.clear();
+            }
         }
 
         // Parse the position command. The position commands comes in a number
@@ -271,16 +385,23 @@ int32_t main(int32_t argc, char* argv[]) {
         // "movetime" or whatever. Who cares? We just need wtime and btime for our super simple
         // time management. We don't even need increment!
         else if (words[0] == "go"){
-            global_depth = 0;
-            total_nodes = 0;
+            stop_and_wait_for_search();
+            tt.wait_until_ready();
             max_hard_time_ms = 10000;
             max_soft_time_ms = 30000;
 
             int64_t base_time = -1;
             int64_t base_inc = -1;
 
-            // Reset all histories
-            reset_killers();
+            // "go ponder ..." searches the position after our predicted ponder move on the
+            // opponent's time. The rest of the command is a normal go, which becomes our
+            // time control once the GUI sends "ponderhit"
+            auto ponder_word = find(words.begin(), words.end(), "ponder");
+            bool ponder = ponder_word != words.end();
+            if (ponder)
+                words.erase(ponder_word);
+
+            infinite_search = words.size() > 1 && words[1] == "infinite";
 
             if (words.size() > 1){
                 if (words[1] == "infinite"){
@@ -327,12 +448,24 @@ int32_t main(int32_t argc, char* argv[]) {
                 }
             }
 
-            search_start_time = chrono::system_clock::now();
-            search_root(board);
+            // Search on the search thread so we can still read "stop",
+            // "isready" and "quit" while thinking
+            search_start_time = chrono::steady_clock::now();
+            pondering = ponder;
+            start_search(board);
+        }
+
+        // The opponent played the move we were pondering on, so the ponder search
+        // carries on as a normal search with the clock starting now
+        else if (words[0] == "ponderhit"){
+            search_start_time = chrono::steady_clock::now();
+            pondering = false;
         }
 
         else if (words[0] == "setoption") {
+            stop_and_wait_for_search();
             string option_name;
+            string value_string;
             int value = 0;
 
             // Find the option name and value in the command
@@ -341,14 +474,82 @@ int32_t main(int32_t argc, char* argv[]) {
                     option_name = words[i + 1];
                 }
                 if (words[i] == "value" && i + 1 < words.size()) {
-                    value = std::stoi(words[i + 1]);
+                    // Everything after "value", file names may contain spaces
+                    value_string = join_words(words, i + 1);
+                    break;
+                }
+            }
+
+            // Check options send true / false, the only string options are the
+            // hash file and shared hash names, everything else is a number
+            bool string_option = option_name == HASH_FILE_OPTION || option_name == SHARED_HASH_OPTION || option_name == EVAL_FILE_OPTION;
+            if (value_string == "true" || value_string == "false")
+                value = value_string == "true";
+            else if (!string_option && !value_string.empty())
+                value = std::stoi(value_string);
+
+            // Loads the network straight away, the previous one stays if it fails
+            if (option_name == EVAL_FILE_OPTION) {
+                if (value_string != "<empty>")
+                    load_eval_file(value_string);
+            }
+
+            else if (option_name == USE_NNUE_OPTION) {
+                if (value && !nnue::is_loaded())
+                    cout << "info string no network loaded, set " << EVAL_FILE_OPTION << " first" << endl;
+                else if (use_nnue != static_cast<bool>(value)){
+                    use_nnue = value;
+                    clear_eval_caches();
                 }
             }
 
+            // Loads the saved TT straight away
+            else if (option_name == HASH_FILE_OPTION) {
+                hash_file = value_string == "<empty>" ? "" : value_string;
+                if (!hash_file.empty()){
+                    tt.wait_until_ready();
+                    load_hash_file(hash_file);
+                }
+            }
+
+            // Set Hash first, the process that creates the segment decides
+            // its size. An empty name goes back to a private table
+            else if (option_name == SHARED_HASH_OPTION) {
+                string name = value_string == "<empty>" ? "" : value_string;
+                tt.wait_until_ready();
+                if (name.empty()){
+                    if (tt.is_shared())
+                        tt.resize(tt_size.current, threads.current);
+                }
+                else if (tt.attach_shared(name, tt_size.current)){
+                    tt_size.set(tt.size_mb());
+                    cout << "info string sharing hash " << name << " (" << tt.size_mb() << " MB)" << endl;
+                }
+                else
+                    cout << "info string could not share hash " << name << endl;
+            }
+
             // Special case: tt_size also resizes TT
-            if (option_name == tt_size.name) {
-                tt_size.set(value);
-                tt.resize(value);
+            else if (option_name == tt_size.name) {
+                if (tt.is_shared())
+                    cout << "info string Hash is fixed by the shared hash" << endl;
+                else {
+                    tt_size.set(value);
+                    tt.resize_async(value, threads.current);
+                }
+            }
+
+            // Threads also creates or destroys search threads
+            else if (option_name == threads.name) {
+                threads.set(value);
+                resize_search_threads(threads.current);
+            }
+
+            // Every thread has its own eval cache of this size
+            else if (option_name == eval_cache_size.name) {
+                eval_cache_size.set(value);
+                for (auto &thread : search_threads)
+                    thread->eval_cache.resize(eval_cache_size.current);
             }
 
             else if (option_name == see_pawn.name){
@@ -387,6 +588,10 @@ int32_t main(int32_t argc, char* argv[]) {
                 for (auto* param : all_params) {
                     if (param->name == option_name) {
                         param->set(value);
+
+                        // Cached evals include the tempo bonus
+                        if (param == &tempo)
+                            clear_eval_caches();
                         break;
                     }
                 }
@@ -397,15 +602,20 @@ int32_t main(int32_t argc, char* argv[]) {
         // the specified depth -- ie. No iterative deepening. Commands
         // should look like search <depth>
         else if (words[0] == "search"){
-            global_depth = 0;
-            total_nodes = 0;
+            stop_and_wait_for_search();
+            tt.wait_until_ready();
+            SearchThread &thread = *search_threads[0];
+            thread.set_board(board);
+            thread.global_depth = 0;
+            thread.total_nodes = 0;
+            thread.stopped = false;
             max_hard_time_ms = 10000000000;
             max_soft_time_ms = 10000000000;
             int32_t depth = stoi(words[1]);
             SearchInfo info{};
-            int32_t score = alpha_beta(board, depth, DEFAULT_ALPHA, DEFAULT_BETA, 0, false, info);
-            cout << "info depth " << depth << " nodes " << total_nodes << " score cp " << score << "\n";
-            cout << "bestmove " << uci::moveToUci(root_best_move) << "\n"; 
+            int32_t score = alpha_beta(thread, depth, DEFAULT_ALPHA, DEFAULT_BETA, 0, false, info);
+            cout << "info depth " << depth << " nodes " << thread.nodes() << " score cp " << score << "\n";
+            cout << "bestmove " << uci::moveToUci(thread.root_best_move) << "\n"; 
         }
 
         // Non-standard UCI command, but very useful for debugging purposes.
@@ -425,6 +635,25 @@ int32_t main(int32_t argc, char* argv[]) {
             cout << see(board, uci::uciToMove(board, words[1]), 0) << "\n";
         }
 
+        // Non-standard UCI commands for keeping analysis across restarts.
+        // save_hash <file> writes the TT to a file, this works while searching.
+        // load_hash <file> reads it back, also resizing the TT to match
+        else if (words[0] == "save_hash" && words.size() > 1){
+            string path = join_words(words, 1);
+            tt.wait_until_ready();
+            std::lock_guard<std::mutex> lock(output_mutex);
+            if (tt.save(path))
+                cout << "info string saved hash to " << path << endl;
+            else
+                cout << "info string could not save hash to " << path << endl;
+        }
+
+        else if (words[0] == "load_hash" && words.size() > 1){
+            stop_and_wait_for_search();
+            tt.wait_until_ready();
+            load_hash_file(join_words(words, 1));
+        }
+
         // Prints openbench spsa config
         else if (words[0] == "obpasta"){
             print_open_bench_config();
@@ -433,14 +662,36 @@ int32_t main(int32_t argc, char* argv[]) {
         // Mostly for debugging purposes. This is a nonstandard UCI command
         // When "seval" is called, we return the static evaluation of the
         // current board position (relative to the current player)
-        else if (words[0] == "seval")
-            cout << evaluate(board) << "\n";
+        else if (words[0] == "seval"){
+            if (use_nnue){
+                nnue::Accumulator acc;
+                nnue::refresh(acc, board);
+                cout << nnue::evaluate(acc, board.sideToMove()) << "\n";
+            }
+            else
+                cout << evaluate(board) << "\n";
+        }
+
+        // Nonstandard, prints how often the pawn hash tables and eval
+        // caches of all threads hit and how often the lazy eval was enough
+        // since the last "cachestats reset". A running search is stopped
+        // first, its counters are not atomic
+        else if (words[0] == "cachestats"){
+            stop_and_wait_for_search();
+            if (words.size() > 1 && words[1] == "reset")
+                reset_cache_stats();
+            else
+                print_cache_stats();
+        }
 
         // When the single match our tournament is over and the GUI doesn't
         // need our engine anymore it sends the "quit" command. Upon
         // receiving this command we end the uci loop and exit our program. 
-        else if (words[0] == "quit")
+        else if (words[0] == "quit"){
+            stop_and_wait_for_search();
+            tt.wait_until_ready();
             break;
+        }
 
     }
 
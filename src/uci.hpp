@@ -7,4 +7,7 @@ inline const std::string ENGINE_AUTHOR  = "Ethan Pan";
 
 inline const std::string STARTPOS_FEN = "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1";
 
-inline const int32_t BENCH_DEPTH = 8;
\ No newline at end of file
+inline const int32_t BENCH_DEPTH = 8;
+inline const int32_t SEE_BENCH_ITERATIONS = 20000;
+inline const int32_t EVAL_BENCH_ITERATIONS = 200;
+inline const int64_t TT_STRESS_OPERATIONS = 20000000;
\ No newline at end of file